@@ -0,0 +1,127 @@
+#!/usr/bin/env python3
+"""
+Checks that the engine keeps the game history across the "position"
+commands sent by main_base.py, both on a ponderhit and on a ponder miss.
+
+The engine plays White, a queen down, and the knights shuffle back to the
+initial squares twice. The final position has then occurred three times.
+Playing g1f3 from there repeats a position that has already occurred
+twice, which the search must score as a draw. That only happens if the
+repetition history survived. In a second game the 50-move counter is
+started at 91 so that it reaches 99 in the final position, where any
+quiet move draws.
+
+Usage:
+  python check_position.py ./cfish
+"""
+
+import re
+import subprocess
+import sys
+
+BOARDS = [
+    "rnbqkbnr/pppppppp/8/8/8/8/PPPPPPPP/RNB1KBNR w KQkq -",
+    "rnbqkb1r/pppppppp/5n2/8/8/5N2/PPPPPPPP/RNB1KB1R w KQkq -",
+]
+
+
+def board_fen(ply, clock):
+    # White to move after 'ply' half moves of knight shuffling
+    return f"{BOARDS[(ply // 2) % 2]} {clock + ply} {ply // 2 + 1}"
+
+
+class Engine:
+    def __init__(self, path):
+        self.proc = subprocess.Popen(
+            [path],
+            stdin=subprocess.PIPE,
+            stdout=subprocess.PIPE,
+            text=True,
+            bufsize=1,
+        )
+
+    def send(self, cmd):
+        self.proc.stdin.write(cmd + "\n")
+
+    def wait_bestmove(self):
+        score = None
+        for line in self.proc.stdout:
+            m = re.search(r" score (cp|mate) (-?\d+)", line)
+            if m:
+                score = (m.group(1), int(m.group(2)))
+            if line.startswith("bestmove"):
+                return score
+        raise RuntimeError("engine exited")
+
+    def quit(self):
+        self.send("quit")
+        self.proc.wait()
+
+
+def play_game(path, clock):
+    """Replays the commands main_base.py sends for a four-move game."""
+    e = Engine(path)
+
+    # Move 1: bare FEN, then ponder on g1f3 g8f6 and get a ponderhit.
+    e.send(f"position fen {board_fen(0, clock)}")
+    e.send("go depth 5")
+    e.wait_bestmove()
+    e.send(f"position fen {board_fen(0, clock)} moves g1f3 g8f6")
+    e.send("go ponder depth 5")
+    e.send("ponderhit")
+    e.wait_bestmove()
+
+    # Move 2: ponder on f3g1 f6g8 and get a ponderhit.
+    e.send(f"position fen {board_fen(2, clock)} moves f3g1 f6g8")
+    e.send("go ponder depth 5")
+    e.send("ponderhit")
+    e.wait_bestmove()
+
+    # Move 3: ponder on g1f3 b8c6, but the opponent plays g8f6.
+    e.send(f"position fen {board_fen(4, clock)} moves g1f3 b8c6")
+    e.send("go ponder depth 5")
+    e.send("stop")
+    e.wait_bestmove()
+    e.send(f"position fen {board_fen(6, clock)}")
+    e.send("go depth 5")
+    e.wait_bestmove()
+
+    # Move 4: ponder on f3g1 f6g8 and get a ponderhit.
+    e.send(f"position fen {board_fen(6, clock)} moves f3g1 f6g8")
+    e.send("go ponder depth 5")
+    e.send("ponderhit")
+    e.wait_bestmove()
+    return e
+
+
+def search_score(e, move):
+    e.send(f"go depth 6 searchmoves {move}")
+    score = e.wait_bestmove()
+    e.quit()
+    return score
+
+
+def main():
+    path = sys.argv[1] if len(sys.argv) > 1 else "./cfish"
+    ok = True
+
+    e = play_game(path, 0)
+    with_history = search_score(e, "g1f3")
+    e = Engine(path)
+    e.send(f"position fen {board_fen(8, 0)}")
+    without_history = search_score(e, "g1f3")
+    print(f"repetition: g1f3 scores {with_history} after the game, "
+          f"{without_history} from the bare FEN")
+    ok &= with_history == ("cp", 0) and without_history != ("cp", 0)
+
+    e = play_game(path, 91)
+    rule50 = search_score(e, "b1c3")
+    print(f"50-move rule: b1c3 at 99 half moves scores {rule50}")
+    ok &= rule50 == ("cp", 0)
+
+    print("OK" if ok else "FAILED")
+    sys.exit(0 if ok else 1)
+
+
+if __name__ == "__main__":
+    main()
@@ -54,3 +54,12 @@ static void init_sliding_attacks(void)
       rook_attacks_EW[occ8 * 4 + sq] = att8;
     }
 }
+
+// slider_attacks_memory() returns the size in bytes of the tables used by
+// this slider attack backend.
+
+size_t slider_attacks_memory(void)
+{
+  return sizeof(queen_mask_v4) + sizeof(bishop_mask_v4)
+       + sizeof(rook_mask_NS) + sizeof(rook_attacks_EW);
+}
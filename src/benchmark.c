@@ -22,12 +22,21 @@
 #include <stdio.h>
 #include <stdlib.h>
 #include <string.h>
+#include <strings.h>
 
+#include "engine.h"
 #include "evaluate.h"
+#ifndef NNUE_PURE
+#include "material.h"
+#endif
 #include "misc.h"
+#include "movegen.h"
 #ifdef NNUE
 #include "nnue.h"
 #endif
+#ifndef NNUE_PURE
+#include "pawns.h"
+#endif
 #include "position.h"
 #include "search.h"
 #include "settings.h"
@@ -36,7 +45,6 @@
 #include "uci.h"
 
 static char *Defaults[] = {
-  "setoption name UCI_Chess960 value false",
   "rnbqkbnr/pppppppp/8/8/8/8/PPPPPPPP/RNBQKBNR w KQkq - 0 1",
   "r3k2r/p1ppqpb1/bn2pnp1/3PN3/1p2P3/2N2Q1p/PPPBBPPP/R3K2R w KQkq - 0 10",
   "8/2p5/3p4/KP5r/1R3p1k/8/4P1P1/8 w - - 0 11",
@@ -90,14 +98,38 @@ static char *Defaults[] = {
   "6k1/3b3r/1p1p4/p1n2p2/1PPNpP1q/P3Q1p1/1R1RB1P1/5K2 b - - 0 1",
   "r2r1n2/pp2bk2/2p1p2p/3q4/3PN1QP/2P3R1/P4PP1/5RK1 w - - 0 1",
   "8/8/8/8/8/6k1/6p1/6K1 w - -",
-  "7k/7P/6K1/8/3B4/8/8/8 b - -",
-
-  // Chess 960
-  "setoption name UCI_Chess960 value true",
-  "bbqnnrkr/pppppppp/8/8/8/8/PPPPPPPP/BBQNNRKR w HFhf - 0 1 moves g2g3 d7d5 d2d4 c8h3 c1g5 e8d6 g5e7 f7f6",
-  "setoption name UCI_Chess960 value false"
+  "7k/7P/6K1/8/3B4/8/8/8 b - -"
 };
 
+// read_fens() reads the positions in the given file, one FEN per line.
+
+static char **read_fens(const char *fenFile, int *numFens)
+{
+  int maxFens = 100;
+  *numFens = 0;
+  FILE *F = fopen(fenFile, "r");
+  if (!F) {
+    fprintf(stderr, "Unable to open file %s\n", fenFile);
+    return NULL;
+  }
+  char **fens = malloc(maxFens * sizeof(*fens));
+  fens[0] = NULL;
+  size_t length = 0;
+  while (getline(&fens[*numFens], &length, F) > 0) {
+    (*numFens)++;
+    if (*numFens == maxFens) {
+      maxFens += 100;
+      fens = realloc(fens, maxFens * sizeof(*fens));
+    }
+    fens[*numFens] = NULL;
+    length = 0;
+  }
+  free(fens[*numFens]);
+  fclose(F);
+
+  return fens;
+}
+
 // benchmark() runs a simple benchmark by letting Stockfish analyze a set
 // of positions for a given limit each. There are six optional parameters:
 // - Transposition table size. Default is 16 MB.
@@ -107,14 +139,18 @@ static char *Defaults[] = {
 //   positions are listed above.
 // - Type of the limit value: depth (default), time (in msecs), nodes.
 // - Evaluation: classical, nnue (hybrid), pure (NNUE only), mixed (default).
+// Any further argument "json" makes benchmark() also print a one-line JSON
+// summary to stdout. With a fixed depth or node limit and a single thread
+// the total node count is deterministic and serves as a bench signature.
 
 void benchmark(Position *current, char *str)
 {
   char *token;
   char **fens;
   int numFens;
+  Engine *e = &DefaultEngine;
 
-  Limits = (struct LimitsType){ 0 };
+  e->limits = (struct LimitsType){ 0 };
 
   int ttSize      = (token = strtok(str , " ")) ? atoi(token)  : 16;
   int threads     = (token = strtok(NULL, " ")) ? atoi(token)  : 1;
@@ -124,20 +160,24 @@ void benchmark(Position *current, char *str)
 #if defined(NNUE) && !defined(NNUE_PURE)
   char *evalType  = (token = strtok(NULL, " ")) ? token        : "mixed";
 #endif
+  bool json = false;
+  while ((token = strtok(NULL, " ")))
+    if (strcasecmp(token, "json") == 0)
+      json = true;
 
   delayedSettings.ttSize = ttSize;
   delayedSettings.numThreads = threads;
   process_delayed_settings();
-  search_clear();
+  search_clear(e);
 
   if (strcmp(limitType, "time") == 0)
-    Limits.movetime = limit; // movetime is in millisecs
+    e->limits.movetime = limit; // movetime is in millisecs
   else if (strcmp(limitType, "nodes") == 0)
-    Limits.nodes = limit;
+    e->limits.nodes = limit;
   else if (strcmp(limitType, "mate") == 0)
-    Limits.mate = limit;
+    e->limits.mate = limit;
   else
-    Limits.depth = limit;
+    e->limits.depth = limit;
 
   if (strcasecmp(fenFile, "default") == 0) {
     fens = Defaults;
@@ -149,36 +189,21 @@ void benchmark(Position *current, char *str)
     pos_fen(current, fens[0]);
     numFens = 1;
   }
-  else {
-    int maxFens = 100;
-    numFens = 0;
-    FILE *F = fopen(fenFile, "r");
-    if (!F) {
-      fprintf(stderr, "Unable to open file %s\n", fenFile);
-      return;
-    }
-    fens = malloc(maxFens * sizeof(*fens));
-    fens[0] = NULL;
-    size_t length = 0;
-    while (getline(&fens[numFens], &length, F) > 0) {
-      numFens++;
-      if (numFens == maxFens) {
-        maxFens += 100;
-        fens = realloc(fens, maxFens * sizeof(*fens));
-      }
-      fens[numFens] = NULL;
-      length = 0;
-    }
-    fclose(F);
-  }
+  else if (!(fens = read_fens(fenFile, &numFens)))
+    return;
 
-  uint64_t nodes = 0;
+  uint64_t nodes = 0, ttProbes = 0, ttHits = 0, evalProbes = 0, evalHits = 0;
+#ifdef TT_STATS
+  TTStats ttStats;
+  memset(&ttStats, 0, sizeof(ttStats));
+#endif
   Position pos;
   memset(&pos, 0, sizeof(pos));
   pos.stackAllocation = malloc(63 + 217 * sizeof(*pos.stack));
   pos.stack = (Stack *)(((uintptr_t)pos.stackAllocation + 0x3f) & ~0x3f);
   pos.st = pos.stack + 7;
   pos.moveList = malloc(10000 * sizeof(*pos.moveList));
+  pos.engine = e;
   TimePoint elapsed = now();
 
   int numOpts = 0;
@@ -206,7 +231,7 @@ void benchmark(Position *current, char *str)
     printf("position fen %s\n", fens[i]);
 
     if (strcasecmp(limitType, "perft") == 0)
-      nodes += perft(&pos, Limits.depth);
+      nodes += perft(&pos, e->limits.depth, true);
     else {
 #if defined(NNUE) && !defined(NNUE_PURE)
       if (strcasecmp(evalType, "classical") == 0)
@@ -219,10 +244,25 @@ void benchmark(Position *current, char *str)
         useNNUE = j & 1 ? EVAL_CLASSICAL : EVAL_HYBRID;
 #endif
 
-      Limits.startTime = now();
+      e->limits.startTime = now();
       start_thinking(&pos, false);
-      thread_wait_until_sleeping(threads_main());
-      nodes += threads_nodes_searched();
+      thread_wait_until_sleeping(threads_main(e));
+      uint64_t cnt = threads_nodes_searched(e);
+      TimePoint t = now() - e->limits.startTime + 1;
+      fprintf(stderr, "Nodes: %" PRIu64 "  Time (ms): %" PRIi64
+                      "  Nodes/second: %" PRIu64 "\n",
+                      cnt, t, 1000 * cnt / t);
+      nodes += cnt;
+      uint64_t probes;
+      ttHits += threads_tt_hits(e, &probes);
+      ttProbes += probes;
+#ifndef NNUE_PURE
+      evalHits += threads_eval_hits(e, &probes);
+      evalProbes += probes;
+#endif
+#ifdef TT_STATS
+      threads_tt_stats(e, &ttStats);
+#endif
     }
   }
 
@@ -233,12 +273,511 @@ void benchmark(Position *current, char *str)
                   "\nNodes searched  : %" PRIu64
                   "\nNodes/second    : %" PRIu64 "\n",
                   elapsed, nodes, 1000 * nodes / elapsed);
+  if (ttProbes)
+    fprintf(stderr, "TT hit rate     : %.2f%%\n", 100.0 * ttHits / ttProbes);
+  if (evalProbes)
+    fprintf(stderr, "Eval cache hits : %.2f%%\n", 100.0 * evalHits / evalProbes);
+#ifdef TT_STATS
+  tt_stats_print(stderr, ttProbes, ttHits, &ttStats);
+#endif
+
+  if (json) {
+    printf("{\"positions\":%d,\"threads\":%d,\"limit\":%" PRIi64
+           ",\"limitType\":\"%s\",\"nodes\":%" PRIu64
+           ",\"time\":%" PRIi64 ",\"nps\":%" PRIu64
+           ",\"ttHitRate\":%.4f,\"evalHitRate\":%.4f}\n",
+           numFens - numOpts, threads, limit, limitType, nodes, elapsed,
+           1000 * nodes / elapsed,
+           ttProbes ? (double)ttHits / ttProbes : 0.0,
+           evalProbes ? (double)evalHits / evalProbes : 0.0);
+    fflush(stdout);
+  }
 
   if (fens != Defaults) {
     for (int i = 0; i < numFens; i++)
       free(fens[i]);
     free(fens);
   }
+  game_free(&pos);
   free(pos.stackAllocation);
   free(pos.moveList);
 }
+
+// The microbench command times single engine components in isolation on
+// the benchmark positions, so that changes to e.g. the slider attack
+// backend can be measured without the noise of a full search.
+
+#if defined(MAGIC_FANCY)
+#define SliderBackend "fancy magics"
+#elif defined(MAGIC_PLAIN)
+#define SliderBackend "plain magics"
+#elif defined(MAGIC_BLACK)
+#define SliderBackend "black magics"
+#elif defined(BMI2_FANCY)
+#define SliderBackend "bmi2 fancy"
+#elif defined(BMI2_PLAIN)
+#define SliderBackend "bmi2 plain"
+#elif defined(AVX2_BITBOARD)
+#define SliderBackend "avx2"
+#endif
+
+enum {
+  MB_LEGAL, MB_CAPTURES, MB_DO_UNDO, MB_EVALUATE, MB_SEE, MB_PSEUDO_LEGAL,
+#ifndef NNUE_PURE
+  MB_PAWN_HIT, MB_PAWN_MISS, MB_MATERIAL_HIT, MB_MATERIAL_FILL,
+#endif
+  MB_TT_PROBE, MB_NB
+};
+
+static const char *MicroNames[MB_NB] = {
+  "generate_legal", "generate_captures", "do_move/undo_move", "evaluate",
+  "see_test", "is_pseudo_legal",
+#ifndef NNUE_PURE
+  "pawn_probe (hit)", "pawn_probe (miss)", "material_probe (hit)",
+  "material_entry_fill",
+#endif
+  "tt_probe"
+};
+
+static uint64_t now_usecs(void)
+{
+  struct timeval tv;
+  gettimeofday(&tv, NULL);
+  return 1000000 * (uint64_t)tv.tv_sec + (uint64_t)tv.tv_usec;
+}
+
+#define TTKeys 4096
+
+// bench_pos_init() sets up a Position with its own stack, move list and
+// evaluation tables for use outside of the search threads.
+
+static void bench_pos_init(Position *pos)
+{
+  memset(pos, 0, sizeof(*pos));
+  pos->stackAllocation = malloc(63 + 217 * sizeof(*pos->stack));
+  pos->stack = (Stack *)(((uintptr_t)pos->stackAllocation + 0x3f) & ~0x3f);
+  pos->st = pos->stack + 7;
+  pos->moveList = malloc(10000 * sizeof(*pos->moveList));
+  pos->engine = &DefaultEngine;
+#ifndef NNUE_PURE
+  pos->pawnTable = calloc(PAWN_ENTRIES * sizeof(PawnEntry), 1);
+  pos->materialTable = calloc(MATERIAL_ENTRIES * sizeof(MaterialHashEntry), 1);
+  pos->pawnMask = PAWN_ENTRIES - 1;
+  pos->materialShift = 64 - msb(MATERIAL_ENTRIES);
+  pos->sliderAttacks = calloc(217, sizeof(SliderAttacks));
+#endif
+}
+
+static void bench_pos_free(Position *pos)
+{
+#ifndef NNUE_PURE
+  free(pos->pawnTable);
+  free(pos->materialTable);
+  free(pos->sliderAttacks);
+#endif
+  game_free(pos);
+  free(pos->stackAllocation);
+  free(pos->moveList);
+}
+
+// micro_run() runs n iterations of the given component on the position
+// and returns the number of operations performed. The results of the
+// operations are added to *sink to keep the compiler from eliding them.
+
+static uint64_t micro_run(Position *pos, int idx, int n, Key *ttKeys,
+    uint64_t *sink)
+{
+  ExtMove *list = pos->moveList, *last;
+  uint64_t ops = 0, sum = 0;
+
+  switch (idx) {
+  case MB_LEGAL:
+    for (int i = 0; i < n; i++)
+      sum += generate_legal(pos, list) - list;
+    ops = n;
+    break;
+
+  case MB_CAPTURES:
+    if (checkers())
+      break;
+    for (int i = 0; i < n; i++)
+      sum += generate_captures(pos, list) - list;
+    ops = n;
+    break;
+
+  case MB_DO_UNDO:
+    last = generate_legal(pos, list);
+    for (int i = 0; i < n; i++)
+      for (ExtMove *m = list; m < last; m++) {
+        do_move(pos, m->move, gives_check(pos, pos->st, m->move));
+        sum += pos->st->key;
+        undo_move(pos, m->move);
+      }
+    ops = (uint64_t)n * (last - list);
+    break;
+
+  case MB_EVALUATE:
+    if (checkers())
+      break;
+    for (int i = 0; i < n; i++)
+      sum += evaluate(pos);
+    ops = n;
+    break;
+
+  case MB_SEE:
+    last = generate_legal(pos, list);
+    for (int i = 0; i < n; i++)
+      for (ExtMove *m = list; m < last; m++)
+        sum += see_test(pos, m->move, 0);
+    ops = (uint64_t)n * (last - list);
+    break;
+
+  // Validate the moves of the position together with both castling moves
+  // of the side to move, as hash and killer moves are validated
+  case MB_PSEUDO_LEGAL:
+    last = generate_legal(pos, list);
+    for (int cr = 0; cr < 2; cr++)
+      (last++)->move = make_castling(square_of(stm(), KING),
+          relative_square(stm(), cr ? SQ_A1 : SQ_H1));
+    for (int i = 0; i < n; i++)
+      for (ExtMove *m = list; m < last; m++)
+        sum += is_pseudo_legal(pos, m->move);
+    ops = (uint64_t)n * (last - list);
+    break;
+
+#ifndef NNUE_PURE
+  case MB_PAWN_HIT:
+    for (int i = 0; i < n; i++)
+      sum += pawn_probe(pos)->passedPawns[WHITE];
+    ops = n;
+    break;
+
+  case MB_PAWN_MISS:
+    for (int i = 0; i < n; i++) {
+      pos->pawnTable[pawn_key() & pos->pawnMask].key = ~pawn_key();
+      sum += pawn_probe(pos)->passedPawns[WHITE];
+    }
+    ops = n;
+    break;
+
+  case MB_MATERIAL_HIT:
+    for (int i = 0; i < n; i++)
+      sum += material_probe(pos).gamePhase;
+    ops = n;
+    break;
+
+  case MB_MATERIAL_FILL:
+    for (int i = 0; i < n; i++) {
+      MaterialEntry me;
+      material_entry_fill(&me, material_key());
+      sum += me.gamePhase;
+    }
+    ops = n;
+    break;
+#endif
+
+  case MB_TT_PROBE:
+    for (int i = 0; i < n; i++) {
+      bool found;
+      TTEntry data;
+      Key k = ttKeys[i & (TTKeys - 1)] ^ pos->st->key;
+      TTEntry *tte = tt_probe(&pos->engine->tt, k, &found, &data);
+      sum += found + (uintptr_t)tte;
+    }
+    ops = n;
+    break;
+  }
+
+  *sink += sum;
+  return ops;
+}
+
+// microbench() times the engine components listed in MicroNames on a set
+// of positions. There are two optional parameters:
+// - Number of iterations per component and position. Default is 1000.
+// - File name with the positions in FEN format, or "default".
+// The results are printed to stdout as one line per component.
+
+void microbench(Position *current, char *str)
+{
+  (void)current;
+  char *token;
+  char **fens;
+  int numFens;
+
+  int iterations = (token = strtok(str , " ")) ? atoi(token) : 1000;
+  char *fenFile  = (token = strtok(NULL, " ")) ? token       : "default";
+  if (iterations < 1)
+    iterations = 1;
+
+  process_delayed_settings();
+
+  if (strcasecmp(fenFile, "default") == 0) {
+    fens = Defaults;
+    numFens = sizeof(Defaults) / sizeof(char *);
+  }
+  else if (!(fens = read_fens(fenFile, &numFens)))
+    return;
+
+  Position pos;
+  bench_pos_init(&pos);
+
+  Key ttKeys[TTKeys];
+  PRNG rng;
+  prng_init(&rng, 1070372);
+  for (int i = 0; i < TTKeys; i++)
+    ttKeys[i] = prng_rand(&rng);
+
+  uint64_t ops[MB_NB] = { 0 }, usecs[MB_NB] = { 0 }, cycles[MB_NB] = { 0 };
+  uint64_t sink = 0;
+
+  for (int i = 0; i < numFens; i++) {
+    char buf[128];
+
+    if (strncmp(fens[i], "setoption ", 9) == 0)
+      continue;
+
+    strcpy(buf, "fen ");
+    strncat(buf, fens[i], 127 - 4);
+    buf[127] = 0;
+    position(&pos, buf);
+
+    for (int idx = 0; idx < MB_NB; idx++) {
+      uint64_t t = now_usecs(), c = now_cycles();
+      ops[idx] += micro_run(&pos, idx, iterations, ttKeys, &sink);
+      cycles[idx] += now_cycles() - c;
+      usecs[idx] += now_usecs() - t;
+    }
+  }
+
+  printf("Slider attacks: %s\n", SliderBackend);
+  printf("%-24s %12s %10s %12s\n", "component", "ops", "ns/op", "cycles/op");
+  for (int idx = 0; idx < MB_NB; idx++) {
+    uint64_t n = ops[idx] ? ops[idx] : 1;
+    printf("%-24s %12" PRIu64 " %10.1f %12.1f\n", MicroNames[idx], ops[idx],
+           1000.0 * usecs[idx] / n, (double)cycles[idx] / n);
+  }
+  printf("checksum: %016" PRIx64 "\n", sink);
+  fflush(stdout);
+
+  if (fens != Defaults) {
+    for (int i = 0; i < numFens; i++)
+      free(fens[i]);
+    free(fens);
+  }
+  bench_pos_free(&pos);
+}
+
+// eval_cmd() prints the evaluation of the current position term by term.
+
+void eval_cmd(Position *current)
+{
+  char buf[128];
+
+  process_delayed_settings();
+
+  Position pos;
+  bench_pos_init(&pos);
+  strcpy(buf, "fen ");
+  pos_fen(current, buf + 4);
+  position(&pos, buf);
+
+#ifndef NNUE_PURE
+  eval_trace(&pos);
+#else
+  Value v = pos.st->checkersBB ? VALUE_NONE : evaluate(&pos);
+  if (v == VALUE_NONE)
+    printf("Final evaluation: none (in check)\n");
+  else
+    printf("Final evaluation: %+.2f (white side)\n",
+           (double)(pos.sideToMove == WHITE ? v : -v) / PawnValueEg);
+  fflush(stdout);
+#endif
+
+  bench_pos_free(&pos);
+}
+
+// evalprofile() times the stages of the classical evaluation on a set of
+// positions and counts how often the lazy exits are taken. There are two
+// optional parameters:
+// - File name with the positions in FEN format, or "default".
+// - Number of evaluations per position. Default is 1000.
+
+void evalprofile(Position *current, char *str)
+{
+  (void)current;
+#ifndef NNUE_PURE
+  char *token;
+  char **fens;
+  int numFens;
+
+  char *fenFile  = (token = strtok(str , " ")) ? token       : "default";
+  int iterations = (token = strtok(NULL, " ")) ? atoi(token) : 1000;
+  if (iterations < 1)
+    iterations = 1;
+
+  process_delayed_settings();
+
+  if (strcasecmp(fenFile, "default") == 0) {
+    fens = Defaults;
+    numFens = sizeof(Defaults) / sizeof(char *);
+  }
+  else if (!(fens = read_fens(fenFile, &numFens)))
+    return;
+
+  Position pos;
+  bench_pos_init(&pos);
+  EvalProfile profile;
+  memset(&profile, 0, sizeof(profile));
+
+  for (int i = 0; i < numFens; i++) {
+    char buf[128];
+
+    if (strncmp(fens[i], "setoption ", 9) == 0)
+      continue;
+
+    strcpy(buf, "fen ");
+    strncat(buf, fens[i], 127 - 4);
+    buf[127] = 0;
+    position(&pos, buf);
+    eval_profile(&pos, &profile, iterations);
+  }
+
+  eval_profile_print(&profile);
+
+  if (fens != Defaults) {
+    for (int i = 0; i < numFens; i++)
+      free(fens[i]);
+    free(fens);
+  }
+  bench_pos_free(&pos);
+#else
+  (void)str;
+  printf("info string evalprofile needs the classical evaluation\n");
+  fflush(stdout);
+#endif
+}
+
+static size_t mem_line(bool print, const char *name, size_t bytes)
+{
+  if (print)
+    printf("%-32s %12zu\n", name, bytes);
+  return bytes;
+}
+
+// static_tables_memory() returns the number of bytes taken by the tables
+// shared by all engines in the process, optionally listing them.
+
+size_t static_tables_memory(bool print)
+{
+  size_t total = 0;
+  char buf[64];
+
+  if (print)
+    printf("static tables:\n");
+  sprintf(buf, "  slider attacks (%s)", SliderBackend);
+  total += mem_line(print, buf, slider_attacks_memory());
+  total += mem_line(print, "  BetweenBB", sizeof(BetweenBB));
+  total += mem_line(print, "  LineBB", sizeof(LineBB));
+#ifndef USE_POPCNT
+  total += mem_line(print, "  PopCnt16", sizeof(PopCnt16));
+#endif
+  total += mem_line(print, "  other bitboards",
+      sizeof(SquareDistance) + sizeof(SquareBB) + sizeof(FileBB)
+    + sizeof(RankBB) + sizeof(ForwardRanksBB) + sizeof(DistanceRingBB)
+    + sizeof(ForwardFileBB) + sizeof(PassedPawnSpan) + sizeof(PawnAttackSpan)
+    + sizeof(PseudoAttacks) + sizeof(PawnAttacks));
+  total += mem_line(print, "  KPK bitbase", bitbases_memory());
+  total += mem_line(print, "  Zobrist keys", sizeof(zob) + sizeof(matKey));
+  total += mem_line(print, "  cuckoo", cuckoo_memory());
+  total += mem_line(print, "  psqt", sizeof(psqt));
+#ifndef NNUE_PURE
+  total += mem_line(print, "  material index", sizeof(materialIndexTable));
+#endif
+#ifdef NNUE
+  total += mem_line(print, "  NNUE weights", nnue_memory());
+#endif
+
+  return total;
+}
+
+// memstat() reports the memory used by the engine's data structures, in
+// bytes, followed by the current and peak resident set size of the process.
+// Pending Hash and Threads settings are applied first.
+
+void memstat(void)
+{
+  Engine *e = &DefaultEngine;
+  size_t total = 0, numCmh = 0;
+  char buf[64];
+
+  process_delayed_settings();
+
+  for (int i = 0; i < e->numCmhTables; i++)
+    numCmh += e->cmhTables[i] != NULL;
+
+  printf("%-32s %12s\n", "structure", "bytes");
+  total += mem_line(true, "transposition table",
+      e->tt.table ? e->tt.clusterCount * sizeof(Cluster) : 0);
+  sprintf(buf, "counter move history (%zu)", numCmh);
+  total += mem_line(true, buf, numCmh * sizeof(CounterMoveHistoryStat));
+
+  size_t perThread = 0;
+  printf("per thread (%d threads):\n", e->threads.numThreads);
+  perThread += mem_line(true, "  position", sizeof(Position));
+  perThread += mem_line(true, "  move list", MOVE_LIST_SIZE);
+  perThread += mem_line(true, "  search stack", STACK_ALLOC_SIZE);
+#ifndef NNUE_PURE
+  perThread += mem_line(true, "  slider attacks", SLIDER_ATTACKS_SIZE);
+#endif
+#ifndef NNUE_PURE
+  sprintf(buf, "  pawn table (%d)", e->pawnEntries);
+  perThread += mem_line(true, buf, e->pawnEntries * sizeof(PawnEntry));
+  sprintf(buf, "  material table (%d)", e->materialEntries);
+  perThread += mem_line(true, buf,
+      e->materialEntries * sizeof(MaterialHashEntry));
+  sprintf(buf, "  eval cache (%d)", e->evalEntries);
+  perThread += mem_line(true, buf, eval_cache_size(e->evalEntries));
+#endif
+  perThread += mem_line(true, "  counter moves", sizeof(CounterMoveStat));
+  perThread += mem_line(true, "  main history", sizeof(ButterflyHistory));
+  perThread += mem_line(true, "  capture history", sizeof(CapturePieceToHistory));
+  perThread += mem_line(true, "  root moves", sizeof(RootMoves));
+  total += e->threads.numThreads * perThread;
+
+  total += static_tables_memory(true);
+
+  mem_line(true, "total", total);
+
+  size_t rss, peak;
+  if (process_memory(&rss, &peak)) {
+    mem_line(true, "current RSS", rss);
+    mem_line(true, "peak RSS", peak);
+  }
+  fflush(stdout);
+}
+
+
+// ttstats() reports how the transposition table behaves in the running or
+// the last search. The detailed counters are only kept in TT_STATS builds.
+
+void ttstats(void)
+{
+  Engine *e = &DefaultEngine;
+  uint64_t probes, hits = threads_tt_hits(e, &probes);
+
+#ifdef TT_STATS
+  TTStats stats;
+  memset(&stats, 0, sizeof(stats));
+  threads_tt_stats(e, &stats);
+  tt_stats_print(stdout, probes, hits, &stats);
+#else
+  printf("TT probes       : %" PRIu64 "\n", probes);
+  printf("TT hits         : %" PRIu64 " (%.2f%%)\n", hits,
+         probes ? 100.0 * hits / probes : 0.0);
+  printf("info string Build with ttstats=yes for collision, cutoff "
+         "and eviction counts.\n");
+#endif
+  printf("TT hashfull     : %d permill\n", e->tt.table ? tt_hashfull(&e->tt) : 0);
+  fflush(stdout);
+}
@@ -147,3 +147,10 @@ void bitbases_init()
 
   free(db);
 }
+
+// bitbases_memory() returns the size in bytes of the KPK bitbase.
+
+size_t bitbases_memory(void)
+{
+  return sizeof(KPKBitbase);
+}
@@ -27,8 +27,10 @@
 
 void bitbases_init(void);
 bool bitbases_probe(Square wksq, Square wpsq, Square bksq, Color us);
+size_t bitbases_memory(void);
 
 void bitboards_init(void);
+size_t slider_attacks_memory(void);
 void print_pretty(Bitboard b);
 
 #define AllSquares (~0ULL)
@@ -42,3 +42,12 @@ static void init_sliding_attacks(void)
             BishopDirs, bmi2_index_bishop);
 }
 
+// slider_attacks_memory() returns the size in bytes of the tables used by
+// this slider attack backend.
+
+size_t slider_attacks_memory(void)
+{
+  return sizeof(RookTable) + sizeof(BishopTable)
+       + sizeof(RookMasks) + sizeof(RookMasks2) + sizeof(RookAttacks)
+       + sizeof(BishopMasks) + sizeof(BishopMasks2) + sizeof(BishopAttacks);
+}
@@ -4,6 +4,10 @@
 //#define LONG_MATES
 #define PER_THREAD_CMH
 
+// The slider attack implementation can also be selected from the Makefile
+// with magic=plain/fancy/black/bmi2-fancy/bmi2-plain/avx2.
+#if  !defined(MAGIC_FANCY) && !defined(MAGIC_PLAIN) && !defined(MAGIC_BLACK) \
+  && !defined(BMI2_FANCY) && !defined(BMI2_PLAIN) && !defined(AVX2_BITBOARD)
 #ifdef USE_PEXT
 //#define BMI2_PLAIN
 #define BMI2_FANCY
@@ -13,5 +17,6 @@
 //#define MAGIC_FANCY
 //#define AVX2_BITBOARD
 #endif
+#endif
 
 #endif
@@ -0,0 +1,47 @@
+#ifndef ENGINE_H
+#define ENGINE_H
+
+#include "params.h"
+#include "search.h"
+#include "thread.h"
+#include "timeman.h"
+#include "tt.h"
+
+// Engine struct holds everything that belongs to one game: the hash table,
+// the thread pool with its search threads, the search limits, the time
+// manager and, in tune=yes builds, the search parameters. Several engines
+// may live in the same process. The static tables (bitboards, Zobrist keys,
+// bitbases, psqt) are shared by all of them.
+
+struct Engine {
+  TranspositionTable tt;
+  ThreadPool threads;
+  LimitsType limits;
+  TimeManagement time;
+  MainThread mainThread;
+  int baseCt;
+  int reductions[MAX_MOVES]; // [depth or moveNumber]
+  CounterMoveHistoryStat **cmhTables;
+  int numCmhTables;
+  int pawnEntries, materialEntries; // per search thread
+  int evalEntries; // per search thread, 0 if the eval cache is off
+  PerftState perft;
+#ifdef TUNE
+  Params params;
+#endif
+  bool silent; // No UCI output, for engines driven by selfplay
+};
+
+extern Engine DefaultEngine; // The engine driven by the UCI loop
+
+// time_elapsed() returns the time spent on the current search, or the
+// number of nodes searched in 'nodes as time' mode. It is defined here
+// rather than in timeman.h as it needs the complete Engine.
+
+INLINE TimePoint time_elapsed(Engine *e)
+{
+  return e->limits.npmsec ? (int64_t)threads_nodes_searched(e)
+                          : now() - e->time.startTime;
+}
+
+#endif
@@ -19,23 +19,27 @@
 */
 
 #include <assert.h>
+#include <inttypes.h>
+#include <stdio.h>
 
 #include "bitboard.h"
+#include "engine.h"
 #include "evaluate.h"
 #include "material.h"
+#include "misc.h"
 #ifdef NNUE
 #include "nnue.h"
 #endif
 #include "pawns.h"
-#include "timeman.h"
 
 #ifndef NNUE_PURE
 
 // Struct EvalInfo contains various information computed and collected
 // by the evaluation functions.
 struct EvalInfo {
-  MaterialEntry *me;
+  MaterialEntry me;
   PawnEntry *pe;
+  const Bitboard *sliderAttacks;
   Bitboard mobilityArea[2];
 
   // attackedBy[color][piece type] is a bitboard representing all squares
@@ -78,10 +82,13 @@ static const Bitboard KingFlank[8] = {
   CenterFiles, KingSide, KingSide, KingSide ^ FileEBB
 };
 
-// Thresholds for lazy and space evaluation
+// Thresholds for lazy and space evaluation. BoundMargin1/2 are what the
+// terms still to be evaluated are assumed to add at most after each stage.
 enum {
   LazyThreshold1 =  3631,
   LazyThreshold2 =  2084,
+  BoundMargin1   =  1536,
+  BoundMargin2   =   512,
   SpaceThreshold = 11551,
   NNUEThreshold1 =   682,
   NNUEThreshold2 =   176
@@ -227,6 +234,43 @@ INLINE void evalinfo_init(const Position *pos, EvalInfo *ei, const Color Us)
 }
 
 
+// slider_attacks() returns the attacks of every bishop, rook and queen as
+// evaluate_pieces() sees them: bishops x-ray through queens, rooks through
+// queens and rooks of their own color. They are kept per Stack entry. If
+// the previous position has them, only sliders on a square changed by the
+// last move, or attacking one, are looked up again and the others are
+// copied.
+
+static const Bitboard *slider_attacks(const Position *pos)
+{
+  Stack *st = pos->st;
+  SliderAttacks *sa = &pos->sliderAttacks[st - pos->stack], *prev = sa - 1;
+
+  if (sa->key == st->key)
+    return sa->attacks;
+
+  Bitboard changed = st->changedBB;
+  bool copy = changed != AllSquares && prev->key == (st-1)->key;
+  Bitboard occ = pieces() ^ pieces_p(QUEEN);
+
+  for (Bitboard b = pieces_pp(BISHOP, ROOK) | pieces_p(QUEEN); b; ) {
+    Square s = pop_lsb(&b);
+    if (copy && !((prev->attacks[s] | sq_bb(s)) & changed)) {
+      sa->attacks[s] = prev->attacks[s];
+      continue;
+    }
+    int pt = type_of_p(piece_on(s));
+    sa->attacks[s] =  pt == BISHOP ? attacks_bb_bishop(s, occ)
+                    : pt == ROOK   ? attacks_bb_rook(s,
+                                       occ ^ pieces_cp(color_of(piece_on(s)), ROOK))
+                    : attacks_from_queen(s);
+  }
+
+  sa->key = st->key;
+  return sa->attacks;
+}
+
+
 // evaluate_piece() assigns bonuses and penalties to the pieces of a given
 // color and type.
 
@@ -246,10 +290,7 @@ INLINE Score evaluate_pieces(const Position *pos, EvalInfo *ei, Score *mobility,
 
   loop_through_pieces(Us, Pt, s) {
     // Find attacked squares, including x-ray attacks for bishops and rooks
-    b = Pt == BISHOP ? attacks_bb_bishop(s, pieces() ^ pieces_p(QUEEN))
-      : Pt == ROOK ? attacks_bb_rook(s,
-                              pieces() ^ pieces_p(QUEEN) ^ pieces_cp(Us, ROOK))
-                   : attacks_from(Pt, s);
+    b = Pt == KNIGHT ? attacks_from_knight(s) : ei->sliderAttacks[s];
 
     if (blockers_for_king(pos, Us) & sq_bb(s))
       b &= LineBB[square_of(Us, KING)][s];
@@ -684,8 +725,11 @@ INLINE Score evaluate_space(const Position *pos, EvalInfo *ei, const Color Us)
 
 // evaluate_winnable() adusts the mg and eg score components based on the
 // known attacking/defending status of the players.
-// A single value is derived from the mg and eg values and returned.
-INLINE Value evaluate_winnable(const Position *pos, EvalInfo *ei, Score score)
+// A single value is derived from the mg and eg values and returned. For
+// eval_trace() the adjustment and the scale factor are stored in *winnable
+// and *scaleFactor unless these are NULL.
+INLINE Value evaluate_winnable(const Position *pos, EvalInfo *ei, Score score,
+    Score *winnable, int *scaleFactor)
 {
   int outflanking = distance_f(square_of(WHITE, KING), square_of(BLACK, KING))
           + rank_of(square_of(WHITE, KING)) - rank_of(square_of(BLACK, KING));
@@ -724,7 +768,7 @@ INLINE Value evaluate_winnable(const Position *pos, EvalInfo *ei, Score score)
 
   // Compute the scale factor for the winning side
   Color strongSide = eg > VALUE_DRAW ? WHITE : BLACK;
-  int sf = material_scale_factor(ei->me, pos, strongSide);
+  int sf = material_scale_factor(&ei->me, pos, strongSide);
 
   // If scale is not already specific, scale down via general heuristics
   if (sf == SCALE_FACTOR_NORMAL) {
@@ -749,24 +793,55 @@ INLINE Value evaluate_winnable(const Position *pos, EvalInfo *ei, Score score)
     sf -= 4 * !pawnsOnBothFlanks;
   }
 
+  if (winnable) {
+    *winnable = make_score(u, v);
+    *scaleFactor = sf;
+  }
+
   // Interpolate between the middlegame and the scaled endgame score
-  v =  mg * ei->me->gamePhase
-     + eg * (PHASE_MIDGAME - ei->me->gamePhase) * sf / SCALE_FACTOR_NORMAL;
+  v =  mg * ei->me.gamePhase
+     + eg * (PHASE_MIDGAME - ei->me.gamePhase) * sf / SCALE_FACTOR_NORMAL;
   v /= PHASE_MIDGAME;
 
   return v;
 }
 
+// bound_skip() tells whether the partial score of the classical evaluation
+// lies so far outside the window (alpha, beta) that the remaining terms are
+// not expected to bring it back. The test is done on the scaled value, as
+// it is returned, since scaling can bring a large score back to a draw.
+// It returns the bound the value would be.
+
+INLINE int bound_skip(const Position *pos, EvalInfo *ei, Score score,
+    Value margin, Value alpha, Value beta)
+{
+  if (alpha == -VALUE_INFINITE && beta == VALUE_INFINITE)
+    return BOUND_EXACT;
+
+  Value v = evaluate_winnable(pos, ei, score, NULL, NULL);
+  if (stm() == BLACK)
+    v = -v;
+
+  return  v - margin >= beta  ? BOUND_LOWER
+        : v + margin <= alpha ? BOUND_UPPER : BOUND_EXACT;
+}
+
 // evaluate_classical() is the classical evaluation function. It returns
 // a static evaluation of the position from the point of view of the side
-// to move.
+// to move. If the evaluation is cut short because it falls outside the
+// window (alpha, beta), *bound is set to BOUND_LOWER or BOUND_UPPER and
+// the partial value minus or plus the margin of the stage is returned, at
+// least beta or at most alpha. Otherwise it is BOUND_EXACT.
 
-static Value evaluate_classical(const Position *pos)
+static Value evaluate_classical(const Position *pos, Value alpha, Value beta,
+    int *bound)
 {
   assert(!checkers());
 
+  *bound = BOUND_EXACT;
+
   Score mobility[2] = { SCORE_ZERO, SCORE_ZERO };
-  Value v;
+  Value v, margin = 0;
   EvalInfo ei;
 
   // Probe the material hash table
@@ -774,14 +849,14 @@ static Value evaluate_classical(const Position *pos)
 
   // If we have a specialized evaluation function for the current material
   // configuration, call it and return.
-  if (material_specialized_eval_exists(ei.me))
-    return material_evaluate(ei.me, pos);
+  if (material_specialized_eval_exists(&ei.me))
+    return material_evaluate(&ei.me, pos);
 
   // Initialize score by reading the incrementally updated scores included
   // in the position struct (material + piece square tables) and the
   // material imbalance. Score is computed internally from the white point
   // of view.
-  Score score = psq_score() + material_imbalance(ei.me);
+  Score score = psq_score() + material_imbalance(&ei.me);
 
   // Probe the pawn hash table
   ei.pe = pawn_probe(pos);
@@ -793,11 +868,17 @@ static Value evaluate_classical(const Position *pos)
   if (lazy_skip(LazyThreshold1))
     goto make_v;
 
+  if ((*bound = bound_skip(pos, &ei, score, BoundMargin1, alpha, beta)) != BOUND_EXACT) {
+    margin = BoundMargin1;
+    goto make_v;
+  }
+
   // Initialize attack and king safety bitboards.
   evalinfo_init(pos, &ei, WHITE);
   evalinfo_init(pos, &ei, BLACK);
 
   // Evaluate all pieces but king and pawns
+  ei.sliderAttacks = slider_attacks(pos);
   score +=  evaluate_pieces(pos, &ei, mobility, WHITE, KNIGHT)
           - evaluate_pieces(pos, &ei, mobility, BLACK, KNIGHT)
           + evaluate_pieces(pos, &ei, mobility, WHITE, BISHOP)
@@ -821,6 +902,11 @@ static Value evaluate_classical(const Position *pos)
   if (lazy_skip(LazyThreshold2))
     goto make_v;
 
+  if ((*bound = bound_skip(pos, &ei, score, BoundMargin2, alpha, beta)) != BOUND_EXACT) {
+    margin = BoundMargin2;
+    goto make_v;
+  }
+
   // Evaluate tactical threats, we need full attack information including king
   score +=  evaluate_threats(pos, &ei, WHITE)
           - evaluate_threats(pos, &ei, BLACK);
@@ -831,7 +917,7 @@ static Value evaluate_classical(const Position *pos)
 
 make_v:
   // Derive single value from the mg and eg parts of the score
-  v = evaluate_winnable(pos, &ei, score);
+  v = evaluate_winnable(pos, &ei, score, NULL, NULL);
 
   // Evaluation grain
   v = (v / 16) * 16;
@@ -839,9 +925,265 @@ make_v:
   // Side to move point of view
   v = (stm() == WHITE ? v : -v);
 
+  return  *bound == BOUND_LOWER ? max(v - margin, beta)
+        : *bound == BOUND_UPPER ? min(v + margin, alpha) : v;
+}
+
+// evaluate_cached() returns evaluate_classical() through the evaluation
+// cache of the thread, if it has one. Only exact values are stored.
+
+static Value evaluate_cached(const Position *pos, Value alpha, Value beta,
+    int *bound)
+{
+  EvalCache *ec = pos->evalCache;
+  if (!ec)
+    return evaluate_classical(pos, alpha, beta, bound);
+
+  uint64_t *entry = &ec->entry[key() & ec->mask];
+  ec->probes++;
+  if (!((*entry ^ key()) & ~0xffffULL)) {
+    ec->hits++;
+    *bound = BOUND_EXACT;
+    return (int16_t)*entry;
+  }
+
+  Value v = evaluate_classical(pos, alpha, beta, bound);
+  if (*bound == BOUND_EXACT && v == (int16_t)v) // Won endgames may score out of range
+    *entry = (key() & ~0xffffULL) | (uint16_t)v;
   return v;
 }
 
+// Terms of the classical evaluation printed by eval_trace()
+enum {
+  TERM_MATERIAL, TERM_IMBALANCE, TERM_PAWNS, TERM_KNIGHTS, TERM_BISHOPS,
+  TERM_ROOKS, TERM_QUEENS, TERM_MOBILITY, TERM_KING, TERM_PASSED,
+  TERM_THREATS, TERM_SPACE, TERM_WINNABLE, TERM_TOTAL, TERM_NB
+};
+
+static const char *TermNames[TERM_NB] = {
+  "Material", "Imbalance", "Pawns", "Knights", "Bishops", "Rooks", "Queens",
+  "Mobility", "King safety", "Passed", "Threats", "Space", "Winnable",
+  "Total"
+};
+
+static double to_pawns(Value v)
+{
+  return (double)v / PawnValueEg;
+}
+
+static void print_term(int t, Score w, Score b, bool perColor)
+{
+  printf("%12s |", TermNames[t]);
+  if (perColor)
+    printf(" %5.2f %5.2f | %5.2f %5.2f |",
+           to_pawns(mg_value(w)), to_pawns(eg_value(w)),
+           to_pawns(mg_value(b)), to_pawns(eg_value(b)));
+  else
+    printf("  ----  ---- |  ----  ---- |");
+  printf(" %5.2f %5.2f\n", to_pawns(mg_value(w - b)), to_pawns(eg_value(w - b)));
+}
+
+// eval_trace() prints the terms of the classical evaluation of the
+// position for both colors, from the white point of view, followed by the
+// value evaluate() returns. Terms which are not evaluated per color are
+// shown only in the total column.
+
+void eval_trace(const Position *pos)
+{
+  if (checkers()) {
+    printf("Final evaluation: none (in check)\n");
+    fflush(stdout);
+    return;
+  }
+
+  Score scores[TERM_NB][2] = { { SCORE_ZERO } };
+  Score mobility[2] = { SCORE_ZERO, SCORE_ZERO };
+  EvalInfo ei;
+  Value v;
+
+  ei.me = material_probe(pos);
+  if (material_specialized_eval_exists(&ei.me)) {
+    v = material_evaluate(&ei.me, pos);
+    printf("Specialized endgame evaluation: %+.2f (white side)\n",
+           to_pawns(stm() == WHITE ? v : -v));
+    goto final;
+  }
+
+  scores[TERM_MATERIAL][WHITE] = psq_score();
+  scores[TERM_IMBALANCE][WHITE] = material_imbalance(&ei.me);
+  ei.pe = pawn_probe(pos);
+  scores[TERM_PAWNS][WHITE] = ei.pe->score;
+
+  evalinfo_init(pos, &ei, WHITE);
+  evalinfo_init(pos, &ei, BLACK);
+  ei.sliderAttacks = slider_attacks(pos);
+  for (int pt = KNIGHT; pt <= QUEEN; pt++) {
+    scores[TERM_KNIGHTS + pt - KNIGHT][WHITE] = evaluate_pieces(pos, &ei, mobility, WHITE, pt);
+    scores[TERM_KNIGHTS + pt - KNIGHT][BLACK] = evaluate_pieces(pos, &ei, mobility, BLACK, pt);
+  }
+  scores[TERM_MOBILITY][WHITE] = mobility[WHITE];
+  scores[TERM_MOBILITY][BLACK] = mobility[BLACK];
+  for (int c = WHITE; c <= BLACK; c++) {
+    scores[TERM_KING][c] = evaluate_king(pos, &ei, mobility, c);
+    scores[TERM_PASSED][c] = evaluate_passed(pos, &ei, c);
+  }
+  for (int c = WHITE; c <= BLACK; c++) {
+    scores[TERM_THREATS][c] = evaluate_threats(pos, &ei, c);
+    scores[TERM_SPACE][c] = evaluate_space(pos, &ei, c);
+  }
+
+  Score score = SCORE_ZERO;
+  for (int t = 0; t < TERM_WINNABLE; t++)
+    score += scores[t][WHITE] - scores[t][BLACK];
+
+  int sf;
+  v = evaluate_winnable(pos, &ei, score, &scores[TERM_WINNABLE][WHITE], &sf);
+  scores[TERM_TOTAL][WHITE] = score + scores[TERM_WINNABLE][WHITE];
+
+  printf("        Term |    White    |    Black    |    Total\n"
+         "             |   MG    EG  |   MG    EG  |   MG    EG\n"
+         " ------------+-------------+-------------+------------\n");
+  for (int t = 0; t < TERM_NB; t++) {
+    if (t == TERM_TOTAL)
+      printf(" ------------+-------------+-------------+------------\n");
+    bool perColor = t >= TERM_KNIGHTS && t <= TERM_SPACE;
+    print_term(t, scores[t][WHITE], scores[t][BLACK], perColor);
+  }
+
+  printf("\nPhase: %d/%d, scale factor: %d/%d\n", ei.me.gamePhase,
+         PHASE_MIDGAME, sf, SCALE_FACTOR_NORMAL);
+  printf("Classical evaluation: %+.2f (white side)\n", to_pawns((v / 16) * 16));
+
+  // The lazy exits look at the partial scores of the first two stages
+  score = scores[TERM_MATERIAL][WHITE] + scores[TERM_IMBALANCE][WHITE]
+         + scores[TERM_PAWNS][WHITE];
+  if (lazy_skip(LazyThreshold1))
+    printf("Lazy exit: after pawns\n");
+  else {
+    for (int t = TERM_KNIGHTS; t <= TERM_PASSED; t++)
+      score += scores[t][WHITE] - scores[t][BLACK];
+    printf("Lazy exit: %s\n", lazy_skip(LazyThreshold2) ? "after passed pawns"
+                                                        : "none");
+  }
+
+final:
+  v = evaluate(pos);
+  printf("Final evaluation: %+.2f (white side)\n",
+         to_pawns(stm() == WHITE ? v : -v));
+  fflush(stdout);
+}
+
+#define TIMED(stage, ...) do { \
+  uint64_t c_ = now_cycles(); \
+  __VA_ARGS__; \
+  p->cycles[stage] += now_cycles() - c_; \
+} while (0)
+
+// eval_profile() runs every stage of the classical evaluation of the
+// position the given number of times and adds the cycles spent per stage
+// to *p, together with the lazy exit the real evaluation would take. The
+// slider attacks are looked up again on every run, the pawn and material
+// entries come from their tables.
+
+void eval_profile(const Position *pos, EvalProfile *p, int iterations)
+{
+  p->positions++;
+  if (checkers()) {
+    p->inCheck++;
+    return;
+  }
+  MaterialEntry me = material_probe(pos);
+  if (material_specialized_eval_exists(&me)) {
+    p->specialized++;
+    return;
+  }
+
+  SliderAttacks *sa = &pos->sliderAttacks[pos->st - pos->stack];
+  int lazy = 0;
+
+  for (int i = 0; i < iterations; i++) {
+    Score score, mobility[2] = { SCORE_ZERO, SCORE_ZERO };
+    EvalInfo ei;
+    Value v;
+
+    uint64_t c = now_cycles();
+    p->overhead += now_cycles() - c;
+    sa->key = ~pos->st->key;
+
+    TIMED(PROF_MATERIAL, ei.me = material_probe(pos);
+                         score = psq_score() + material_imbalance(&ei.me));
+    TIMED(PROF_PAWNS, ei.pe = pawn_probe(pos); score += ei.pe->score);
+    if (!i && lazy_skip(LazyThreshold1))
+      lazy = 1;
+    TIMED(PROF_INIT, evalinfo_init(pos, &ei, WHITE);
+                     evalinfo_init(pos, &ei, BLACK);
+                     ei.sliderAttacks = slider_attacks(pos));
+    TIMED(PROF_KNIGHTS, score +=  evaluate_pieces(pos, &ei, mobility, WHITE, KNIGHT)
+                                - evaluate_pieces(pos, &ei, mobility, BLACK, KNIGHT));
+    TIMED(PROF_BISHOPS, score +=  evaluate_pieces(pos, &ei, mobility, WHITE, BISHOP)
+                                - evaluate_pieces(pos, &ei, mobility, BLACK, BISHOP));
+    TIMED(PROF_ROOKS, score +=  evaluate_pieces(pos, &ei, mobility, WHITE, ROOK)
+                              - evaluate_pieces(pos, &ei, mobility, BLACK, ROOK));
+    TIMED(PROF_QUEENS, score +=  evaluate_pieces(pos, &ei, mobility, WHITE, QUEEN)
+                               - evaluate_pieces(pos, &ei, mobility, BLACK, QUEEN));
+    score += mobility[WHITE] - mobility[BLACK];
+    TIMED(PROF_KING, score +=  evaluate_king(pos, &ei, mobility, WHITE)
+                             - evaluate_king(pos, &ei, mobility, BLACK));
+    TIMED(PROF_PASSED, score +=  evaluate_passed(pos, &ei, WHITE)
+                               - evaluate_passed(pos, &ei, BLACK));
+    if (!i && !lazy && lazy_skip(LazyThreshold2))
+      lazy = 2;
+    TIMED(PROF_THREATS, score +=  evaluate_threats(pos, &ei, WHITE)
+                                - evaluate_threats(pos, &ei, BLACK));
+    TIMED(PROF_SPACE, score +=  evaluate_space(pos, &ei, WHITE)
+                              - evaluate_space(pos, &ei, BLACK));
+    TIMED(PROF_WINNABLE, v = evaluate_winnable(pos, &ei, score, NULL, NULL));
+    p->sink += v;
+  }
+
+  p->calls += iterations;
+  if (lazy)
+    p->lazySkips[lazy - 1]++;
+}
+
+#undef TIMED
+
+// eval_profile_print() prints the results gathered by eval_profile(). The
+// cycles are per evaluation, less the overhead of reading the counter.
+
+void eval_profile_print(const EvalProfile *p)
+{
+  static const char *names[PROF_NB] = {
+    "material", "pawns", "attack init", "knights", "bishops", "rooks",
+    "queens", "king safety", "passed", "threats", "space", "winnable"
+  };
+
+  uint64_t evaluated = p->positions - p->inCheck - p->specialized;
+  uint64_t full = evaluated - p->lazySkips[0] - p->lazySkips[1];
+  double n = evaluated ? evaluated : 1;
+  double calls = p->calls ? p->calls : 1;
+  double overhead = p->overhead / calls, cycles[PROF_NB], total = 0;
+
+  for (int s = 0; s < PROF_NB; s++)
+    total += cycles[s] = max(p->cycles[s] / calls - overhead, 0.0);
+
+  printf("Positions       : %" PRIu64 " (in check %" PRIu64
+         ", specialized %" PRIu64 ")\n",
+         p->positions, p->inCheck, p->specialized);
+  printf("Lazy exit 1     : %" PRIu64 " (%.2f%%)\n", p->lazySkips[0],
+         100.0 * p->lazySkips[0] / n);
+  printf("Lazy exit 2     : %" PRIu64 " (%.2f%%)\n", p->lazySkips[1],
+         100.0 * p->lazySkips[1] / n);
+  printf("Full evaluation : %" PRIu64 " (%.2f%%)\n", full, 100.0 * full / n);
+  printf("\n%-16s %12s %8s\n", "stage", "cycles/eval", "share");
+  for (int s = 0; s < PROF_NB; s++)
+    printf("%-16s %12.1f %7.2f%%\n", names[s], cycles[s],
+           total ? 100.0 * cycles[s] / total : 0.0);
+  printf("%-16s %12.1f\n", "total", total);
+  printf("checksum: %016" PRIx64 "\n", p->sink);
+  fflush(stdout);
+}
+
 #ifdef NNUE
 int useNNUE;
 
@@ -871,13 +1213,32 @@ static Value fix_FRC(const Position *pos)
 
 #define adjusted_NNUE() \
   (nnue_evaluate(pos) * (580 + mat / 32 - 4 * rule50_count()) / 1024 \
-   + Time.tempoNNUE + (is_chess960() ? fix_FRC(pos) : 0))
+   + pos->engine->time.tempoNNUE + (is_chess960() ? fix_FRC(pos) : 0))
 
 #endif
 
-Value evaluate(const Position *pos)
+// evaluate_bounded() is evaluate() for callers that only need to know how
+// the evaluation compares to the window (alpha, beta). The classical
+// evaluation may then stop early and return a lower bound of at least beta
+// or an upper bound of at most alpha, which is reported in *bound. The bound
+// is the partial value with the margin of the skipped terms, so callers can
+// still use it as an estimate, e.g. for futility pruning. NNUE values are
+// always exact.
+
+Value evaluate_bounded(const Position *pos, Value alpha, Value beta,
+    int *bound)
 {
-  Value v;
+  Value v, a = -VALUE_INFINITE, b = VALUE_INFINITE;
+
+  // Bring the window to the scale of the classical evaluation, which is
+  // damped below when shuffling
+  int damp = 195 - rule50_count();
+  if (damp > 0 && alpha > -VALUE_INFINITE && beta < VALUE_INFINITE) {
+    a = alpha * 211 / damp;
+    b = beta * 211 / damp;
+  }
+
+  *bound = BOUND_EXACT;
 
 #ifdef NNUE
 
@@ -891,33 +1252,54 @@ Value evaluate(const Position *pos)
     bool lowPieceEndgame =   non_pawn_material() == BishopValueMg
                           || (non_pawn_material() < 2 * RookValueMg
                               && popcount(pieces_p(PAWN)) < 2);
-    v = classical || lowPieceEndgame ? evaluate_classical(pos)
+
+    // The switch to NNUE below looks at the classical value, so it needs
+    // an exact one.
+    bool mayUseNNUE = classical && largePsq && !lowPieceEndgame;
+    if (mayUseNNUE)
+      a = -VALUE_INFINITE, b = VALUE_INFINITE;
+    v = classical || lowPieceEndgame ? evaluate_cached(pos, a, b, bound)
                                      : adjusted_NNUE();
 
-    if (   classical && largePsq && !lowPieceEndgame
+    if (   mayUseNNUE
         && (   abs(v) * 16 < NNUEThreshold2 * r50
             || (   opposite_bishops(pos)
                 && abs(v) * 16 < (NNUEThreshold1 + non_pawn_material() / 64) * r50
                 && !(pos->nodes & 0xB))))
+    {
       v = adjusted_NNUE();
+      *bound = BOUND_EXACT;
+    }
 
   } else if (useNNUE == EVAL_PURE)
     v = adjusted_NNUE();
   else
-    v = evaluate_classical(pos);
+    v = evaluate_cached(pos, a, b, bound);
 
 #else
 
-  v = evaluate_classical(pos);
+  v = evaluate_cached(pos, a, b, bound);
 
 #endif
 
   // Damp down the evalation linearly when shuffling
   v = v * (195 - rule50_count()) / 211;
 
+  // Rounding in the rescaling must not move a bound into the window
+  if (*bound == BOUND_LOWER)
+    v = max(v, beta);
+  else if (*bound == BOUND_UPPER)
+    v = min(v, alpha);
+
   return clamp(v, VALUE_TB_LOSS_IN_MAX_PLY + 1, VALUE_TB_WIN_IN_MAX_PLY - 1);
 }
 
+Value evaluate(const Position *pos)
+{
+  int bound;
+  return evaluate_bounded(pos, -VALUE_INFINITE, VALUE_INFINITE, &bound);
+}
+
 #else /* NNUE_PURE */
 
 Value evaluate(const Position *pos)
@@ -930,4 +1312,12 @@ Value evaluate(const Position *pos)
   return clamp(v, VALUE_TB_LOSS_IN_MAX_PLY + 1, VALUE_TB_WIN_IN_MAX_PLY - 1);
 }
 
+Value evaluate_bounded(const Position *pos, Value alpha, Value beta,
+    int *bound)
+{
+  (void)alpha, (void)beta;
+  *bound = BOUND_EXACT;
+  return evaluate(pos);
+}
+
 #endif
@@ -1,6 +1,7 @@
 #ifndef EVALUATE_H
 #define EVALUATE_H
 
+#include "bitboard.h"
 #include "types.h"
 
 #define DefaultEvalFile "nn-62ef826d1a6d.nnue"
@@ -14,6 +15,55 @@ extern int useNNUE;
 #endif
 #endif
 
+// Each search thread caches its classical evaluations in a direct-mapped
+// table indexed by the low bits of the position key. An entry holds the
+// upper 48 bits of the key with the evaluation in the lower 16 bits. The
+// size of the table is set by the EvalCache option in kB; 0 disables it.
+// The option is disabled in pure NNUE builds.
+
+#define EVAL_CACHE_KB 64
+
+#ifndef NNUE_PURE
+
+struct EvalCache {
+  uint64_t probes, hits;
+  uint64_t mask;
+  uint64_t entry[];
+};
+
+INLINE int eval_cache_entries(size_t kb)
+{
+  size_t n = kb * 1024 / sizeof(uint64_t);
+  return n ? 1 << msb(n) : 0;
+}
+
+INLINE size_t eval_cache_size(int entries)
+{
+  return entries ? sizeof(EvalCache) + entries * sizeof(uint64_t) : 0;
+}
+
+// Stages of the classical evaluation timed by eval_profile()
+enum {
+  PROF_MATERIAL, PROF_PAWNS, PROF_INIT, PROF_KNIGHTS, PROF_BISHOPS,
+  PROF_ROOKS, PROF_QUEENS, PROF_KING, PROF_PASSED, PROF_THREATS, PROF_SPACE,
+  PROF_WINNABLE, PROF_NB
+};
+
+struct EvalProfile {
+  uint64_t positions, inCheck, specialized;
+  uint64_t lazySkips[2]; // Positions taking the first or second lazy exit
+  uint64_t calls, overhead, sink;
+  uint64_t cycles[PROF_NB];
+};
+
+void eval_trace(const Position *pos);
+void eval_profile(const Position *pos, EvalProfile *p, int iterations);
+void eval_profile_print(const EvalProfile *p);
+
+#endif
+
 Value evaluate(const Position *pos);
+Value evaluate_bounded(const Position *pos, Value alpha, Value beta,
+    int *bound);
 
 #endif
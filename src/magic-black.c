@@ -185,3 +185,12 @@ static void init_sliding_attacks(void)
               BishopDirs, magic_index_bishop);
 }
 
+// slider_attacks_memory() returns the size in bytes of the tables used by
+// this slider attack backend.
+
+size_t slider_attacks_memory(void)
+{
+  return sizeof(AttacksTable)
+       + sizeof(RookMasks) + sizeof(RookMagics) + sizeof(RookAttacks)
+       + sizeof(BishopMasks) + sizeof(BishopMagics) + sizeof(BishopAttacks);
+}
@@ -98,3 +98,13 @@ static void init_sliding_attacks(void)
               BishopShifts, BishopDirs, magic_index_bishop);
 }
 
+// slider_attacks_memory() returns the size in bytes of the tables used by
+// this slider attack backend.
+
+size_t slider_attacks_memory(void)
+{
+  return sizeof(RookTable) + sizeof(BishopTable)
+       + sizeof(RookMasks) + sizeof(RookMagics) + sizeof(RookAttacks)
+       + sizeof(RookShifts) + sizeof(BishopMasks) + sizeof(BishopMagics)
+       + sizeof(BishopAttacks) + sizeof(BishopShifts);
+}
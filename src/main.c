@@ -21,7 +21,9 @@
 #include <stdio.h>
 
 #include "bitboard.h"
+#include "engine.h"
 #include "endgame.h"
+#include "numa.h"
 #include "pawns.h"
 #include "position.h"
 #include "search.h"
@@ -40,15 +42,21 @@ int main(int argc, char **argv)
 #ifndef NNUE_PURE
   endgames_init();
 #endif
-  threads_init();
+#ifdef NUMA
+  numa_init();
+#endif
+  threads_init(&DefaultEngine);
   options_init();
-  search_clear();
+  search_clear(&DefaultEngine);
 
   uci_loop(argc, argv);
 
-  threads_exit();
+  threads_exit(&DefaultEngine);
+#ifdef NUMA
+  numa_exit();
+#endif
   options_free();
-  tt_free();
+  tt_free(&DefaultEngine.tt);
   #ifdef NNUE
   nnue_free();
   #endif
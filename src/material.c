@@ -49,24 +49,50 @@ static const Score QuadraticTheirs[][8] = {
 
 #undef S
 
+// The entries are 64-bit atomics that are 0 until they have been filled.
+// The table is placed in the BSS, so its untouched pages cost no memory.
+_Alignas(64) MaterialIndexTable materialIndexTable;
+
+// Weight of each piece in the material index, and the largest count of
+// each piece type that the index can represent.
+const uint32_t MaterialIndexWeight[16] = {
+  0, 1, 9, 27, 81, 243, 0, 0,
+  0, 1 * 486, 9 * 486, 27 * 486, 81 * 486, 243 * 486, 0, 0
+};
+
+static const int MaterialIndexMax[8] = { 0, 8, 2, 2, 2, 1, 1, 0 };
+
+// Piece counts and non-pawn material read off a material key, which holds
+// the count of each piece in a nibble.
+#define mk_count(k,c,p) ((int)(((k) >> (20 * (c) + 4 * (p) + 4)) & 15))
+
+static Value mk_npm(Key key, int c)
+{
+  Value v = 0;
+  for (int pt = KNIGHT; pt <= QUEEN; pt++)
+    v += mk_count(key, c, pt) * PieceValue[MG][pt];
+  return v;
+}
+
 // Helper used to detect a given material distribution.
-INLINE bool is_KXK(const Position *pos, int us)
+INLINE bool is_KXK(Key key, int us)
 {
-  return  !more_than_one(pieces_c(!us))
-        && non_pawn_material_c(us) >= RookValueMg;
+  return  !mk_count(key, !us, PAWN)
+        && !mk_npm(key, !us)
+        && mk_npm(key, us) >= RookValueMg;
 }
 
-INLINE bool is_KBPsK(const Position *pos, int us)
+INLINE bool is_KBPsK(Key key, int us)
 {
-  return   non_pawn_material_c(us) == BishopValueMg
-        && pieces_cp(us, PAWN);
+  return   mk_npm(key, us) == BishopValueMg
+        && mk_count(key, us, PAWN);
 }
 
-INLINE bool is_KQKRPs(const Position *pos, int us) {
-  return  !piece_count(us, PAWN)
-        && non_pawn_material_c(us) == QueenValueMg
-        && piece_count(!us, ROOK) == 1
-        && pieces_cp(!us, PAWN);
+INLINE bool is_KQKRPs(Key key, int us) {
+  return  !mk_count(key, us, PAWN)
+        && mk_npm(key, us) == QueenValueMg
+        && mk_count(key, !us, ROOK) == 1
+        && mk_count(key, !us, PAWN);
 }
 
 // imbalance() calculates the imbalance by comparing the piece count of each
@@ -94,22 +120,16 @@ static Score imbalance(int us, int pieceCount[][8])
   return bonus;
 }
 
-typedef int PieceCountType[2][8];
+// material_entry_fill() computes the MaterialEntry of the material
+// configuration with the given key. Only the piece counts encoded in the
+// key are used, so entries can be computed without a position.
 
-// material_probe() looks up the current position's material configuration
-// in the material hash table. It returns a pointer to the MaterialEntry
-// if the position is found. Otherwise a new Entry is computed and stored
-// there, so we don't have to recompute all when the same material
-// configuration occurs again.
-
-void material_entry_fill(const Position *pos, MaterialEntry *e, Key key)
+void material_entry_fill(MaterialEntry *e, Key key)
 {
   memset(e, 0, sizeof(MaterialEntry));
-  e->key = key;
-  e->factor[WHITE] = e->factor[BLACK] = (uint8_t)SCALE_FACTOR_NORMAL;
 
-  Value npm_w = non_pawn_material_c(WHITE);
-  Value npm_b = non_pawn_material_c(BLACK);
+  Value npm_w = mk_npm(key, WHITE);
+  Value npm_b = mk_npm(key, BLACK);
   Value npm = clamp(npm_w + npm_b, EndgameLimit, MidgameLimit);
   e->gamePhase = ((npm - EndgameLimit) * PHASE_MIDGAME) / (MidgameLimit - EndgameLimit);
 
@@ -117,15 +137,13 @@ void material_entry_fill(const Position *pos, MaterialEntry *e, Key key)
   for (int i = 0; i < NUM_EVAL; i++)
     for (int c = 0; c < 2; c++)
       if (endgame_keys[i][c] == key) {
-        e->eval_func = 1 + i;
-        e->eval_func_side = c;
+        e->eval_func = (1 + i) | c << 4;
         return;
       }
 
   for (int c = 0; c < 2; c++)
-    if (is_KXK(pos, c)) {
-      e->eval_func = 10; // EvaluateKXK
-      e->eval_func_side = c;
+    if (is_KXK(key, c)) {
+      e->eval_func = 10 | c << 4; // EvaluateKXK
       return;
     }
 
@@ -141,25 +159,28 @@ void material_entry_fill(const Position *pos, MaterialEntry *e, Key key)
   // generic ones that refer to more than one material distribution. Note
   // that in this case we do not return after setting the function.
   for (int c = 0; c < 2; c++) {
-    if (is_KBPsK(pos, c))
+    if (is_KBPsK(key, c))
       e->scal_func[c] = 17; // ScaleKBPsK
 
-    else if (is_KQKRPs(pos, c))
+    else if (is_KQKRPs(key, c))
       e->scal_func[c] = 18; // ScaleKQKRPs
   }
 
-  if (npm_w + npm_b == 0 && pieces_p(PAWN)) { // Only pawns on the board.
-    if (!pieces_cp(BLACK, PAWN)) {
-      assert(piece_count(WHITE, PAWN) >= 2);
+  int pawns_w = mk_count(key, WHITE, PAWN);
+  int pawns_b = mk_count(key, BLACK, PAWN);
+
+  if (npm_w + npm_b == 0 && pawns_w + pawns_b) { // Only pawns on the board.
+    if (!pawns_b) {
+      assert(pawns_w >= 2);
 
       e->scal_func[WHITE] = 19; // ScaleKPsK
     }
-    else if (!pieces_cp(WHITE, PAWN)) {
-      assert(piece_count(BLACK, PAWN) >= 2);
+    else if (!pawns_w) {
+      assert(pawns_b >= 2);
 
       e->scal_func[BLACK] = 19; // ScaleKPsK
     }
-    else if (popcount(pieces_p(PAWN)) == 2) { // Each side has one pawn.
+    else if (pawns_w + pawns_b == 2) { // Each side has one pawn.
       // This is a special case because we set scaling functions
       // for both colors instead of only one.
       e->scal_func[WHITE] = 20; // ScaleKPKP
@@ -171,18 +192,20 @@ void material_entry_fill(const Position *pos, MaterialEntry *e, Key key)
   // material advantage. This catches some trivial draws like KK, KBK and
   // KNK and gives a drawish scale factor for cases such as KRKBP and
   // KmmKm (except for KBBKN).
-  if (!piece_count(WHITE, PAWN) && npm_w - npm_b <= BishopValueMg)
-    e->factor[WHITE] = (uint8_t)(npm_w <  RookValueMg   ? SCALE_FACTOR_DRAW :
-                                 npm_b <= BishopValueMg ? 4 : 14);
+  // The factor is stored as an index into MaterialFactor: 1 is
+  // SCALE_FACTOR_DRAW, 2 is 4 and 3 is 14.
+  if (!pawns_w && npm_w - npm_b <= BishopValueMg)
+    e->scal_func[WHITE] |= (npm_w <  RookValueMg   ? 1 :
+                            npm_b <= BishopValueMg ? 2 : 3) << 5;
 
-  if (!piece_count(BLACK, PAWN) && npm_b - npm_w <= BishopValueMg)
-    e->factor[BLACK] = (uint8_t)(npm_b <  RookValueMg   ? SCALE_FACTOR_DRAW :
-                                 npm_w <= BishopValueMg ? 4 : 14);
+  if (!pawns_b && npm_b - npm_w <= BishopValueMg)
+    e->scal_func[BLACK] |= (npm_b <  RookValueMg   ? 1 :
+                            npm_w <= BishopValueMg ? 2 : 3) << 5;
 
   // Evaluate the material imbalance. We use PIECE_TYPE_NONE as a place
   // holder for the bishop pair "extended piece", which allows us to be
   // more flexible in defining bishop pair bonuses.
-#define pc(c,p) piece_count_mk(c,p)
+#define pc(c,p) mk_count(key,c,p)
   int PieceCount[2][8] = {
     { pc(0, BISHOP) > 1, pc(0, PAWN), pc(0, KNIGHT),
       pc(0, BISHOP)    , pc(0, ROOK), pc(0, QUEEN) },
@@ -194,6 +217,49 @@ void material_entry_fill(const Position *pos, MaterialEntry *e, Key key)
   e->score = make_score(mg_value(tmp) / 16, eg_value(tmp) / 16);
 }
 
+// material_index() computes the material index of a position from its
+// piece counts, or returns MATERIAL_INDEX_NONE if a count is too large.
+
+uint32_t material_index(const Position *pos)
+{
+  uint32_t idx = 0;
+
+  for (int c = 0; c < 2; c++)
+    for (int pt = PAWN; pt <= QUEEN; pt++) {
+      int n = piece_count(c, pt);
+      if (n > MaterialIndexMax[pt])
+        return MATERIAL_INDEX_NONE;
+      idx += n * MaterialIndexWeight[make_piece(c, pt)];
+    }
+
+  return idx;
+}
+
+// material_index_fill() fills the entry of materialIndexTable with the
+// given index and returns it. Threads may fill the same entry at the same
+// time, but they compute the same value and each publishes it with a single
+// relaxed atomic store, so a reader sees either 0 or the complete entry.
+
+uint64_t material_index_fill(uint32_t idx)
+{
+  Key key = matKey[W_KING] + matKey[B_KING];
+  uint32_t rest = idx;
+
+  for (int c = 0; c < 2; c++)
+    for (int pt = PAWN; pt <= QUEEN; pt++) {
+      int n = rest % (MaterialIndexMax[pt] + 1);
+      rest /= MaterialIndexMax[pt] + 1;
+      key += n * matKey[make_piece(c, pt)];
+    }
+
+  union MaterialBits b = { 0 };
+  material_entry_fill(&b.entry, key);
+  b.entry.eval_func |= MATERIAL_FILLED;
+  atomic_store_explicit(&materialIndexTable[idx], b.raw, memory_order_relaxed);
+
+  return b.raw;
+}
+
 #else
 
 typedef int make_iso_compilers_happy;
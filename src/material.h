@@ -26,6 +26,21 @@
 #include "position.h"
 #include "types.h"
 
+// Default number of entries in the material hash table. The actual number
+// is set per engine and must be a power of 2.
+#define MATERIAL_ENTRIES 1024
+
+// Material configurations with at most 8 pawns, 2 knights, 2 bishops,
+// 2 rooks and 1 queen per side are looked up directly in materialIndexTable.
+// Their index is a mixed-radix number over the piece counts that do_move()
+// keeps up to date in st->materialIndex. The table is filled lazily, on the
+// first probe of each configuration, so only the pages of configurations
+// that occur are ever touched. The remaining configurations only arise
+// after promotions and go through the per-thread hash table.
+#define MATERIAL_INDEX_SIDE 486 // 9 * 3 * 3 * 3 * 2
+#define MATERIAL_INDEX_SIZE (MATERIAL_INDEX_SIDE * MATERIAL_INDEX_SIDE)
+#define MATERIAL_INDEX_NONE 0xffffffffU
+
 // MaterialEntry contains various information about a material
 // configuration. It contains a material imbalance evaluation, a function
 // pointer to a special endgame evaluation function (which in most cases
@@ -36,34 +51,89 @@
 // For instance, in KRB vs KR endgames, the score is scaled down by a
 // factor of 4, which will result in scores of absolute value less than
 // one pawn.
+//
+// The entry is packed into 8 bytes, so that an entry of materialIndexTable
+// is published and read with a single atomic access:
+// - eval_func: endgame function in bits 0-3, its side in bit 4 and in bit 7
+//   MATERIAL_FILLED, so that a filled entry is never 0.
+// - scal_func[c]: scaling function in bits 0-4, and in bits 5-6 an index
+//   into MaterialFactor of the scale factor used if there is no function.
+
+enum { MATERIAL_FILLED = 0x80 };
 
 struct MaterialEntry {
-  Key key;
-  int16_t gamePhase;
   Score score;
+  uint8_t gamePhase;
   uint8_t eval_func;
-  uint8_t eval_func_side;
   uint8_t scal_func[2];
-  uint8_t factor[2];
 };
 
 typedef struct MaterialEntry MaterialEntry;
 
-typedef MaterialEntry MaterialTable[1024];
+union MaterialBits {
+  MaterialEntry entry;
+  uint64_t raw;
+};
+
+_Static_assert(sizeof(MaterialEntry) == sizeof(uint64_t),
+               "MaterialEntry must fit in 64 bits");
+
+struct MaterialHashEntry {
+  Key key;
+  MaterialEntry entry;
+};
+
+typedef _Atomic uint64_t MaterialIndexTable[MATERIAL_INDEX_SIZE];
+
+#ifndef NNUE_PURE
 
-void material_entry_fill(const Position *pos, MaterialEntry *e, Key key);
+extern MaterialIndexTable materialIndexTable;
+extern const uint32_t MaterialIndexWeight[16];
 
-INLINE MaterialEntry *material_probe(const Position *pos)
+void material_entry_fill(MaterialEntry *e, Key key);
+uint64_t material_index_fill(uint32_t idx);
+uint32_t material_index(const Position *pos);
+
+// material_probe() returns a copy of the entry of the position. Entries of
+// materialIndexTable are shared by all threads and are read with a single
+// load, see material_index_fill().
+
+INLINE MaterialEntry material_probe(const Position *pos)
 {
+  uint32_t idx = pos->st->materialIndex;
+  if (likely(idx != MATERIAL_INDEX_NONE)) {
+    union MaterialBits b;
+    b.raw = atomic_load_explicit(&materialIndexTable[idx],
+                                 memory_order_relaxed);
+    if (unlikely(!b.raw))
+      b.raw = material_index_fill(idx);
+    return b.entry;
+  }
+
   Key key = material_key();
-  MaterialEntry *e = &pos->materialTable[key >> (64-10)];
+  MaterialHashEntry *he = &pos->materialTable[key >> pos->materialShift];
+
+  if (unlikely(he->key != key)) {
+    he->key = key;
+    material_entry_fill(&he->entry, key);
+  }
+
+  return he->entry;
+}
 
-  if (unlikely(e->key != key))
-    material_entry_fill(pos, e, key);
+// material_prefetch() prefetches the entry material_probe() will read.
 
-  return e;
+INLINE void material_prefetch(const Position *pos)
+{
+  uint32_t idx = pos->st->materialIndex;
+  if (likely(idx != MATERIAL_INDEX_NONE))
+    prefetch((void *)&materialIndexTable[idx]);
+  else
+    prefetch(&pos->materialTable[material_key() >> pos->materialShift]);
 }
 
+#endif
+
 INLINE Score material_imbalance(MaterialEntry *me)
 {
   return me->score;
@@ -71,12 +141,12 @@ INLINE Score material_imbalance(MaterialEntry *me)
 
 INLINE bool material_specialized_eval_exists(MaterialEntry *me)
 {
-  return me->eval_func != 0;
+  return (me->eval_func & 15) != 0;
 }
 
 INLINE Value material_evaluate(MaterialEntry *me, const Position *pos)
 {
-  return endgame_funcs[me->eval_func](pos, me->eval_func_side);
+  return endgame_funcs[me->eval_func & 15](pos, (me->eval_func >> 4) & 1);
 }
 
 // scale_factor takes a position and a color as input and returns a scale factor
@@ -87,10 +157,14 @@ INLINE Value material_evaluate(MaterialEntry *me, const Position *pos)
 INLINE int material_scale_factor(MaterialEntry *me, const Position *pos,
     Color c)
 {
+  static const uint8_t MaterialFactor[4] = {
+    SCALE_FACTOR_NORMAL, SCALE_FACTOR_DRAW, 4, 14
+  };
+
   int sf = SCALE_FACTOR_NONE;
-  if (me->scal_func[c])
-    sf = endgame_funcs[me->scal_func[c]](pos, c);
-  return sf != SCALE_FACTOR_NONE ? sf : me->factor[c];
+  if (me->scal_func[c] & 31)
+    sf = endgame_funcs[me->scal_func[c] & 31](pos, c);
+  return sf != SCALE_FACTOR_NONE ? sf : MaterialFactor[me->scal_func[c] >> 5];
 }
 
 #endif
@@ -441,3 +441,33 @@ void free_memory(alloc_t *alloc)
   munmap(alloc->ptr, alloc->size);
 #endif
 }
+
+// process_memory() returns the current and the peak resident set size of
+// the process in bytes, as reported by the kernel. It returns false if the
+// information is not available.
+
+bool process_memory(size_t *current, size_t *peak)
+{
+#ifdef __linux__
+  FILE *F = fopen("/proc/self/status", "r");
+  if (!F)
+    return false;
+
+  char line[128];
+  unsigned long kb;
+  *current = *peak = 0;
+  while (fgets(line, sizeof(line), F)) {
+    if (sscanf(line, "VmRSS: %lu kB", &kb) == 1)
+      *current = (size_t)kb * 1024;
+    else if (sscanf(line, "VmHWM: %lu kB", &kb) == 1)
+      *peak = (size_t)kb * 1024;
+  }
+  fclose(F);
+
+  return *current && *peak;
+#else
+  (void)current;
+  (void)peak;
+  return false;
+#endif
+}
@@ -29,6 +29,9 @@
 #include <stdatomic.h>
 #include <sys/time.h>
 #include <unistd.h>
+#if defined(__x86_64__) || defined(__i386__)
+#include <x86intrin.h>
+#endif
 
 #include "types.h"
 
@@ -73,6 +76,18 @@ INLINE TimePoint now(void) {
   return 1000 * (uint64_t)tv.tv_sec + (uint64_t)tv.tv_usec / 1000;
 }
 
+// now_cycles() reads the time stamp counter, or returns 0 where there is
+// none. It is only used for profiling.
+
+INLINE uint64_t now_cycles(void)
+{
+#if defined(__x86_64__) || defined(__i386__)
+  return __rdtsc();
+#else
+  return 0;
+#endif
+}
+
 #ifdef _WIN32
 bool large_pages_supported(void);
 extern size_t largePageMinimum;
@@ -108,6 +123,7 @@ const void *map_file(FD fd, map_t *map);
 void unmap_file(const void *data, map_t map);
 void *allocate_memory(size_t size, bool lp, alloc_t *alloc);
 void free_memory(alloc_t *alloc);
+bool process_memory(size_t *current, size_t *peak);
 
 struct PRNG
 {
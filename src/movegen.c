@@ -154,17 +154,43 @@ INLINE ExtMove *generate_pawn_moves(const Position *pos, ExtMove *list,
 }
 
 
+// filter_pawn_moves() removes from the pawn moves in (cur, end) those of
+// pinned pawns that leave the pin ray and en passant captures that expose
+// the king. The order of the remaining moves is kept.
+
+INLINE ExtMove *filter_pawn_moves(const Position *pos, ExtMove *cur,
+    ExtMove *end, Bitboard pinned, Square ksq)
+{
+  if (!(pinned & pieces_p(PAWN)) && !ep_square())
+    return end;
+
+  ExtMove *list = cur;
+  for (; cur < end; cur++)
+    if (   !((pinned & sq_bb(from_sq(cur->move))) && !aligned(cur->move, ksq))
+        && (type_of_m(cur->move) != ENPASSANT || is_legal(pos, cur->move)))
+      (list++)->move = cur->move;
+
+  return list;
+}
+
+
 INLINE ExtMove *generate_moves(const Position *pos, ExtMove *list,
-    Bitboard target, const Color Us, const int Pt, const bool Checks)
+    Bitboard target, const Color Us, const int Pt, const bool Checks,
+    Bitboard pinned, Square ksq)
 {
   assert(Pt != KING && Pt != PAWN);
 
-  Bitboard bb = pieces_cp(Us, Pt);
+  // A pinned knight can never move
+  Bitboard bb = pieces_cp(Us, Pt) & (Pt == KNIGHT ? ~pinned : AllSquares);
 
   while (bb) {
     Square from = pop_lsb(&bb);
     Bitboard b = attacks_bb(Pt, from, pieces()) & target;
 
+    // A pinned slider may only move along the pin ray
+    if (pinned & sq_bb(from))
+      b &= LineBB[ksq][from];
+
     if (Checks && (Pt == QUEEN || !(blockers_for_king(pos, !Us) & sq_bb(from))))
       b &= pos->st->checkSquares[Pt];
 
@@ -176,11 +202,17 @@ INLINE ExtMove *generate_moves(const Position *pos, ExtMove *list,
 }
 
 
+// generate_all() generates the moves of the given type. If Legal is set,
+// only legal moves are generated: pinned pieces are kept on their pin ray,
+// the king does not step onto attacked squares, and the few en passant
+// captures and castling moves are checked with is_legal().
+
 INLINE ExtMove *generate_all(const Position *pos, ExtMove *list, const Color Us,
-  const int Type)
+  const int Type, const bool Legal)
 {
   const bool Checks = Type == QUIET_CHECKS;
   const Square ksq = square_of(Us, KING);
+  const Bitboard pinned = Legal ? blockers_for_king(pos, Us) & pieces_c(Us) : 0;
   Bitboard target;
 
   if (Type == EVASIONS && more_than_one(checkers()))
@@ -190,11 +222,14 @@ INLINE ExtMove *generate_all(const Position *pos, ExtMove *list, const Color Us,
           : Type == NON_EVASIONS ? ~pieces_c(Us)
           : Type == CAPTURES     ? pieces_c(!Us) : ~pieces();
 
+  ExtMove *pawnMoves = list;
   list = generate_pawn_moves(pos, list, target, Us, Type);
-  list = generate_moves(pos, list, target, Us, KNIGHT, Checks);
-  list = generate_moves(pos, list, target, Us, BISHOP, Checks);
-  list = generate_moves(pos, list, target, Us,   ROOK, Checks);
-  list = generate_moves(pos, list, target, Us,  QUEEN, Checks);
+  if (Legal)
+    list = filter_pawn_moves(pos, pawnMoves, list, pinned, ksq);
+  list = generate_moves(pos, list, target, Us, KNIGHT, Checks, pinned, ksq);
+  list = generate_moves(pos, list, target, Us, BISHOP, Checks, pinned, ksq);
+  list = generate_moves(pos, list, target, Us,   ROOK, Checks, pinned, ksq);
+  list = generate_moves(pos, list, target, Us,  QUEEN, Checks, pinned, ksq);
 
 kingMoves:
   if (!Checks || blockers_for_king(pos, !Us) & sq_bb(ksq)) {
@@ -202,17 +237,25 @@ kingMoves:
     if (Checks)
       b &= ~PseudoAttacks[QUEEN][square_of(!Us, KING)];
 
-    while (b)
-      (list++)->move = make_move(ksq, pop_lsb(&b));
+    while (b) {
+      Square to = pop_lsb(&b);
+      if (   !Legal
+          || !(attackers_to_occ(pos, to, pieces() ^ sq_bb(ksq)) & pieces_c(!Us)))
+        (list++)->move = make_move(ksq, to);
+    }
 
     if ((Type == QUIETS || Type == NON_EVASIONS) && can_castle_c(Us)) {
       const int OO = make_castling_right(Us, KING_SIDE);
-      if (!castling_impeded(OO) && can_castle_cr(OO))
-        (list++)->move = make_castling(ksq, castling_rook_square(OO));
+      if (!castling_impeded(OO) && can_castle_cr(OO)) {
+        list->move = make_castling(ksq, castling_rook_square(OO));
+        list += !Legal || is_legal(pos, list->move);
+      }
 
       const int OOO = make_castling_right(Us, QUEEN_SIDE);
-      if (!castling_impeded(OOO) && can_castle_cr(OOO))
-        (list++)->move = make_castling(ksq, castling_rook_square(OOO));
+      if (!castling_impeded(OOO) && can_castle_cr(OOO)) {
+        list->move = make_castling(ksq, castling_rook_square(OOO));
+        list += !Legal || is_legal(pos, list->move);
+      }
     }
   }
 
@@ -233,64 +276,139 @@ kingMoves:
 //
 // generate_non_evasions() generates all pseudo-legal captures and
 // non-captures.
+//
+// The generate_legal_*() variants generate only the legal moves of each
+// kind, so that the move picker hands out moves that need no is_legal().
 
-INLINE ExtMove *generate(const Position *pos, ExtMove *list, const int Type)
+INLINE ExtMove *generate(const Position *pos, ExtMove *list, const int Type,
+    const bool Legal)
 {
   assert(Type != LEGAL);
   assert((Type == EVASIONS) == (bool)checkers());
 
   Color us = stm();
 
-  return us == WHITE ? generate_all(pos, list, WHITE, Type)
-                     : generate_all(pos, list, BLACK, Type);
+  return us == WHITE ? generate_all(pos, list, WHITE, Type, Legal)
+                     : generate_all(pos, list, BLACK, Type, Legal);
 }
 
 // "template" instantiations
 
 NOINLINE ExtMove *generate_captures(const Position *pos, ExtMove *list)
 {
-  return generate(pos, list, CAPTURES);
+  return generate(pos, list, CAPTURES, false);
 }
 
 NOINLINE ExtMove *generate_quiets(const Position *pos, ExtMove *list)
 {
-  return generate(pos, list, QUIETS);
+  return generate(pos, list, QUIETS, false);
 }
 
 NOINLINE ExtMove *generate_evasions(const Position *pos, ExtMove *list)
 {
-  return generate(pos, list, EVASIONS);
+  return generate(pos, list, EVASIONS, false);
 }
 
 NOINLINE ExtMove *generate_quiet_checks(const Position *pos, ExtMove *list)
 {
-  return generate(pos, list, QUIET_CHECKS);
+  return generate(pos, list, QUIET_CHECKS, false);
 }
 
 NOINLINE ExtMove *generate_non_evasions(const Position *pos, ExtMove *list)
 {
-  return generate(pos, list, NON_EVASIONS);
+  return generate(pos, list, NON_EVASIONS, false);
 }
 
 
-// generate_legal() generates all the legal moves in the given position
-NOINLINE ExtMove *generate_legal(const Position *pos, ExtMove *list)
+NOINLINE ExtMove *generate_legal_captures(const Position *pos, ExtMove *list)
+{
+  return generate(pos, list, CAPTURES, true);
+}
+
+NOINLINE ExtMove *generate_legal_quiets(const Position *pos, ExtMove *list)
 {
+  return generate(pos, list, QUIETS, true);
+}
+
+NOINLINE ExtMove *generate_legal_evasions(const Position *pos, ExtMove *list)
+{
+  return generate(pos, list, EVASIONS, true);
+}
+
+NOINLINE ExtMove *generate_legal_quiet_checks(const Position *pos,
+    ExtMove *list)
+{
+  return generate(pos, list, QUIET_CHECKS, true);
+}
+
+
+// generate_captures_of() generates the legal captures of the enemy pieces
+// of type pt, least valuable attacker first. For pt == 0 it generates the
+// queen and checking knight promotions that capture nothing. Called for
+// pt from QUEEN down to 0, it yields the moves of generate_legal_captures()
+// in MVV/LVA order.
+
+NOINLINE ExtMove *generate_captures_of(const Position *pos, ExtMove *list,
+    int pt)
+{
+  assert(!checkers());
+
   Color us = stm();
-  Bitboard pinned = blockers_for_king(pos, us) & pieces_c(us);
   Square ksq = square_of(us, KING);
-  ExtMove *cur = list;
-
-  list = checkers() ? generate_evasions(pos, list)
-                    : generate_non_evasions(pos, list);
-  while (cur != list)
-    if (  (  (pinned && pinned & sq_bb(from_sq(cur->move)))
-           || from_sq(cur->move) == ksq
-           || type_of_m(cur->move) == ENPASSANT)
-        && !is_legal(pos, cur->move))
-      cur->move = (--list)->move;
-    else
-      ++cur;
+  Bitboard pinned = blockers_for_king(pos, us) & pieces_c(us);
+  Bitboard rank7 = us == WHITE ? Rank7BB : Rank2BB;
+
+  if (pt == 0) {
+    Bitboard b = pieces_cp(us, PAWN) & rank7;
+    b = (us == WHITE ? b << 8 : b >> 8) & ~pieces();
+    while (b) {
+      Square to = pop_lsb(&b), from = to - pawn_push(us);
+      if ((pinned & sq_bb(from)) && !aligned(make_move(from, to), ksq))
+        continue;
+      (list++)->move = make_promotion(from, to, QUEEN);
+      if (attacks_from_knight(to) & sq_bb(pos->st->ksq))
+        (list++)->move = make_promotion(from, to, KNIGHT);
+    }
+    return list;
+  }
+
+  for (Bitboard victims = pieces_cp(!us, pt); victims; ) {
+    Square to = pop_lsb(&victims);
+    Bitboard attackers = attackers_to(to) & pieces_c(us);
+
+    for (int apt = PAWN; apt <= KING && attackers; apt++) {
+      Bitboard b = attackers & pieces_p(apt);
+      attackers ^= b;
+      while (b) {
+        Square from = pop_lsb(&b);
+        if (apt == KING) {
+          if (attackers_to_occ(pos, to, pieces() ^ sq_bb(ksq)) & pieces_c(!us))
+            continue;
+        } else if ((pinned & sq_bb(from)) && !aligned(make_move(from, to), ksq))
+          continue;
+        if (apt == PAWN && (rank7 & sq_bb(from))) {
+          (list++)->move = make_promotion(from, to, QUEEN);
+          if (attacks_from_knight(to) & sq_bb(pos->st->ksq))
+            (list++)->move = make_promotion(from, to, KNIGHT);
+        } else
+          (list++)->move = make_move(from, to);
+      }
+    }
+  }
+
+  if (pt == PAWN && ep_square())
+    for (Bitboard b = pieces_cp(us, PAWN) & attacks_from_pawn(ep_square(), !us); b; ) {
+      list->move = make_enpassant(pop_lsb(&b), ep_square());
+      list += is_legal(pos, list->move);
+    }
 
   return list;
 }
+
+
+// generate_legal() generates all the legal moves in the given position
+NOINLINE ExtMove *generate_legal(const Position *pos, ExtMove *list)
+{
+  return checkers() ? generate(pos, list, EVASIONS, true)
+                    : generate(pos, list, NON_EVASIONS, true);
+}
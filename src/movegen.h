@@ -36,6 +36,11 @@ ExtMove *generate_quiet_checks(const Position *pos, ExtMove *list);
 ExtMove *generate_evasions(const Position *pos, ExtMove *list);
 ExtMove *generate_non_evasions(const Position *pos, ExtMove *list);
 ExtMove *generate_legal(const Position *pos, ExtMove *list);
+ExtMove *generate_legal_captures(const Position *pos, ExtMove *list);
+ExtMove *generate_legal_quiets(const Position *pos, ExtMove *list);
+ExtMove *generate_legal_evasions(const Position *pos, ExtMove *list);
+ExtMove *generate_legal_quiet_checks(const Position *pos, ExtMove *list);
+ExtMove *generate_captures_of(const Position *pos, ExtMove *list, int pt);
 
 #endif
 
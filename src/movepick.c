@@ -120,7 +120,9 @@ static void score_evasions(const Position *pos)
 }
 
 
-// next_move() returns the next pseudo-legal move to be searched.
+// next_move() returns the next move to be searched. All moves it returns
+// are legal: the generated ones are generated legal and the hash, killer
+// and counter moves are checked with is_legal().
 
 Move next_move(const Position *pos, bool skipQuiets)
 {
@@ -136,7 +138,7 @@ Move next_move(const Position *pos, bool skipQuiets)
 
   case ST_CAPTURES_INIT:
     st->endBadCaptures = st->cur = (st-1)->endMoves;
-    st->endMoves = generate_captures(pos, st->cur);
+    st->endMoves = generate_legal_captures(pos, st->cur);
     score_captures(pos);
     st->stage++;
     /* fallthrough */
@@ -157,7 +159,7 @@ Move next_move(const Position *pos, bool skipQuiets)
     // First killer move.
     move = st->mpKillers[0];
     if (move && move != st->ttMove && is_pseudo_legal(pos, move)
-             && !is_capture(pos, move))
+             && !is_capture(pos, move) && is_legal(pos, move))
       return move;
     /* fallthrough */
 
@@ -165,7 +167,7 @@ Move next_move(const Position *pos, bool skipQuiets)
     st->stage++;
     move = st->mpKillers[1]; // Second killer move.
     if (move && move != st->ttMove && is_pseudo_legal(pos, move)
-             && !is_capture(pos, move))
+             && !is_capture(pos, move) && is_legal(pos, move))
       return move;
     /* fallthrough */
 
@@ -174,14 +176,14 @@ Move next_move(const Position *pos, bool skipQuiets)
     move = st->countermove;
     if (move && move != st->ttMove && move != st->mpKillers[0]
              && move != st->mpKillers[1] && is_pseudo_legal(pos, move)
-             && !is_capture(pos, move))
+             && !is_capture(pos, move) && is_legal(pos, move))
       return move;
     /* fallthrough */
 
   case ST_QUIET_INIT:
     if (!skipQuiets) {
       st->cur = st->endBadCaptures;
-      st->endMoves = generate_quiets(pos, st->cur);
+      st->endMoves = generate_legal_quiets(pos, st->cur);
       score_quiets(pos);
       partial_insertion_sort(st->cur, st->endMoves, -3000 * st->depth);
     }
@@ -207,7 +209,7 @@ Move next_move(const Position *pos, bool skipQuiets)
 
   case ST_EVASIONS_INIT:
     st->cur = (st-1)->endMoves;
-    st->endMoves = generate_evasions(pos, st->cur);
+    st->endMoves = generate_legal_evasions(pos, st->cur);
     score_evasions(pos);
     st->stage++;
 
@@ -220,22 +222,30 @@ Move next_move(const Position *pos, bool skipQuiets)
     break;
 
   case ST_QCAPTURES_INIT:
-    st->cur = (st-1)->endMoves;
-    st->endMoves = generate_captures(pos, st->cur);
-    score_captures(pos);
+    // Captures are generated one victim type at a time, most valuable
+    // first, so that a cutoff spares generating the others.
+    st->cur = st->endMoves = (st-1)->endMoves;
+    st->victim = QUEEN;
     st->stage++;
+    /* fallthrough */
 
   case ST_QCAPTURES:
-    while (st->cur < st->endMoves) {
-      move = pick_best(st->cur++, st->endMoves);
-      if (move != st->ttMove && (st->depth > DEPTH_QS_RECAPTURES
-              || to_sq(move) == st->recaptureSquare))
-        return move;
+    for (;;) {
+      while (st->cur < st->endMoves) {
+        move = (st->cur++)->move;
+        if (move != st->ttMove && (st->depth > DEPTH_QS_RECAPTURES
+                || to_sq(move) == st->recaptureSquare))
+          return move;
+      }
+      if (st->victim < 0)
+        break;
+      st->cur = (st-1)->endMoves;
+      st->endMoves = generate_captures_of(pos, st->cur, st->victim--);
     }
     if (st->depth <= DEPTH_QS_NO_CHECKS)
       break;
     st->cur = (st-1)->endMoves;
-    st->endMoves = generate_quiet_checks(pos, st->cur);
+    st->endMoves = generate_legal_quiet_checks(pos, st->cur);
     st->stage++;
     /* fallthrough */
 
@@ -249,7 +259,7 @@ Move next_move(const Position *pos, bool skipQuiets)
 
   case ST_PROBCUT_INIT:
     st->cur = (st-1)->endMoves;
-    st->endMoves = generate_captures(pos, st->cur);
+    st->endMoves = generate_legal_captures(pos, st->cur);
     score_captures(pos);
     st->stage++;
     /* fallthrough */
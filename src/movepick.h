@@ -86,7 +86,7 @@ INLINE void mp_init(const Position *pos, Move ttm, Depth d, int ply)
 
   st->ttMove = ttm;
   st->stage = checkers() ? ST_EVASION : ST_MAIN_SEARCH;
-  if (!ttm || !is_pseudo_legal(pos, ttm))
+  if (!ttm || !is_pseudo_legal(pos, ttm) || !is_legal(pos, ttm))
     st->stage++;
 }
 
@@ -100,7 +100,8 @@ INLINE void mp_init_q(const Position *pos, Move ttm, Depth d, Square s)
   st->stage = checkers() ? ST_EVASION : ST_QSEARCH;
   if (!(   ttm
         && (checkers() || d > DEPTH_QS_RECAPTURES || to_sq(ttm) == s)
-        && is_pseudo_legal(pos, ttm)))
+        && is_pseudo_legal(pos, ttm)
+        && is_legal(pos, ttm)))
     st->stage++;
 
   st->depth = d;
@@ -121,7 +122,7 @@ INLINE void mp_init_pc(const Position *pos, Move ttm, Value th)
   // In ProbCut we generate captures with SEE higher than the given
   // threshold.
   if (!(ttm && is_pseudo_legal(pos, ttm) && is_capture(pos, ttm)
-            && see_test(pos, ttm, th)))
+            && is_legal(pos, ttm) && see_test(pos, ttm, th)))
     st->stage++;
 }
 
@@ -674,3 +674,13 @@ void nnue_free(void)
   if (ft_biases)
     free_memory(&ft_alloc);
 }
+
+// nnue_memory() returns the size in bytes of the network weights.
+
+size_t nnue_memory(void)
+{
+  return (ft_biases ? 2 * kHalfDimensions * (FtInDims + 1) : 0)
+       + sizeof(hidden1_weights) + sizeof(hidden2_weights)
+       + sizeof(output_weights) + sizeof(hidden1_biases)
+       + sizeof(hidden2_biases) + sizeof(output_biases);
+}
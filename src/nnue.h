@@ -15,6 +15,7 @@ typedef struct {
 
 void nnue_init(void);
 void nnue_free(void);
+size_t nnue_memory(void);
 Value nnue_evaluate(const Position *pos);
 void nnue_export_net(void);
 
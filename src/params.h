@@ -0,0 +1,172 @@
+#ifndef PARAMS_H
+#define PARAMS_H
+
+#include "types.h"
+
+// Search and time management parameters that can be tuned with SPSA.
+// Each entry is PARAM(name, default, min, max). In a normal build every
+// parameter is a compile-time constant. When compiled with -DTUNE (make
+// tune=yes) they become variables that are exposed as UCI spin options.
+// Names, scales and ranges follow scripts/spsa.py; a range is only widened
+// where it would not contain the default. Values that the code uses as
+// fractions are scaled by a power of 10, see the time_init() formulas.
+
+#define PARAMS \
+  PARAM(futilityMarginGain,             165,    100,    200) \
+  PARAM(reductionA,                    1642,   1000,   2000) \
+  PARAM(reductionB,                    1024,    500,   1500) \
+  PARAM(reductionC,                     916,    500,   1500) \
+  PARAM(statBonusA,                      12,      1,     30) \
+  PARAM(statBonusB,                     282,    100,    500) \
+  PARAM(statBonusC,                     349,    100,    500) \
+  PARAM(statBonusD,                    1594,   1000,   2000) \
+  PARAM(reductionInit,                 2184,   1000,   3000) \
+  PARAM(counterMoveHistoryThreshold,     -9,   -150,      0) \
+  PARAM(aspirationDeltaA,                13,      0,     30) \
+  PARAM(aspirationDeltaB,             15753,  10000,  20000) \
+  PARAM(aspirationDeltaC,                 4,      2,      7) \
+  PARAM(aspirationDeltaD,                 2,      1,     10) \
+  PARAM(bonusInitialGain,                 0,   -100,      0) \
+  PARAM(bonusInitialThreshold,         1870,   1000,   3000) \
+  PARAM(improvementDefault,             125,      0,    400) \
+  PARAM(mateBetaDelta,                  126,     50,    250) \
+  PARAM(mateDepthThreshold,               5,      1,     10) \
+  PARAM(mateExtraBonus,                  69,     10,    100) \
+  PARAM(futilityBaseDelta,              155,     50,    200) \
+  PARAM(razoringA,                     -406,   -500,      0) \
+  PARAM(razoringB,                     -280,   -500,      0) \
+  PARAM(futilityA,                      338,    100,    500) \
+  PARAM(futilityDepth,                    8,      3,     12) \
+  PARAM(nullMoveThreshA,              16227,  10000,  20000) \
+  PARAM(nullMoveThreshB,                -29,   -100,      0) \
+  PARAM(nullMoveThreshC,                 12,      1,     20) \
+  PARAM(nullMoveThreshD,                213,    100,    500) \
+  PARAM(nullMoveThreshE,                 23,      1,     50) \
+  PARAM(nullMoveRA,                     151,    100,    500) \
+  PARAM(nullMoveRB,                       7,      1,     20) \
+  PARAM(nullMoveRC,                       3,      1,     10) \
+  PARAM(nullMoveRD,                       4,      1,     10) \
+  PARAM(nullMoveRE,                     781,    100,   1500) \
+  PARAM(nullMoveDepth,                   13,      8,     20) \
+  PARAM(nullMovePlyA,                     2,      1,      5) \
+  PARAM(nullMovePlyB,                     3,      1,      8) \
+  PARAM(probCutBetaA,                   185,    100,    300) \
+  PARAM(probCutBetaB,                    56,     10,    100) \
+  PARAM(probCutDepthLimit,                4,      1,     10) \
+  PARAM(probCutDepth,                     4,      1,     10) \
+  PARAM(ttDecreaseA,                      3,      1,      5) \
+  PARAM(ttDecreaseB,                      1,      1,      5) \
+  PARAM(ttDecreaseDepth,                  9,      1,     20) \
+  PARAM(probCutBetaC,                   413,    300,    500) \
+  PARAM(probCutDepthThresh,               2,      1,      5) \
+  PARAM(shallowPruningDepthA,             8,      1,     15) \
+  PARAM(shallowPruningA,                192,    100,    300) \
+  PARAM(shallowPruningB,                205,    100,    300) \
+  PARAM(shallowPruningC,                  7,      1,     10) \
+  PARAM(sseThreshold,                  -201,   -500,      0) \
+  PARAM(shallowPruningDepthB,             5,      1,     10) \
+  PARAM(shallowPruningD,              -4076,  -5000,  -1000) \
+  PARAM(shallowPruningGain,               2,      1,      5) \
+  PARAM(shallowPruningDepthC,            14,      1,     20) \
+  PARAM(shallowPruningE,                108,     50,    200) \
+  PARAM(shallowPruningF,                151,    100,    200) \
+  PARAM(shallowPruningG,                 61,     10,    100) \
+  PARAM(shallowPruningH,                -27,   -100,      0) \
+  PARAM(shallowPruningI,                -16,    -50,      0) \
+  PARAM(singularExtDepthA,                5,      1,      8) \
+  PARAM(singularExtDepthB,                2,      1,      5) \
+  PARAM(singularExtDepthC,                2,      1,      5) \
+  PARAM(singularBetaA,                    3,      1,      5) \
+  PARAM(singularExtentionA,              23,     10,     50) \
+  PARAM(singularExtentionB,               9,      5,     15) \
+  PARAM(singularExtDepthD,               10,      5,     15) \
+  PARAM(singularExtentionC,              81,     50,    150) \
+  PARAM(singularExtentionD,            4632,   1000,  10000) \
+  PARAM(lmrDepthThreshold,                1,      1,      5) \
+  PARAM(lmrMoveCountThreshold,            8,      1,     15) \
+  PARAM(lmrDecTTPv,                       2,      0,      3) \
+  PARAM(lmrDecMoveCount,                  2,      0,      3) \
+  PARAM(lmrDecSingular,                   0,      0,      3) \
+  PARAM(lmrIncCutNode,                    2,      0,      3) \
+  PARAM(lmrIncTTCapture,                  1,      0,      3) \
+  PARAM(lmrPvNodeA,                       2,      1,      5) \
+  PARAM(lmrPvNodeB,                      10,      1,     20) \
+  PARAM(lmrPvNodeC,                       4,      1,      5) \
+  PARAM(lmrCutoffCntThresh,               3,      1,      5) \
+  PARAM(lmrIncCutoffCnt,                  2,      0,      3) \
+  PARAM(lmrStatGain,                      3,      1,      5) \
+  PARAM(lmrStatDelta,                  4850,   1000,  10000) \
+  PARAM(lmrRDecA,                     12855,  10000,  20000) \
+  PARAM(lmrRDecB,                      3631,   1000,  10000) \
+  PARAM(lmrRDecDepthA,                    8,      3,     10) \
+  PARAM(lmrRDecDepthB,                   18,     11,     30) \
+  PARAM(lmrDeepSearchA,                  60,     10,    100) \
+  PARAM(lmrDeepSearchB,                  11,      1,     20) \
+  PARAM(fallingEvalA,                   318,     10,    318) \
+  PARAM(fallingEvalB,                     6,      5,     25) \
+  PARAM(fallingEvalC,                     6,      3,     10) \
+  PARAM(fallingEvalD,                   825,    100,   1000) \
+  PARAM(fallingEvalClampMin,             50,      1,     99) \
+  PARAM(fallingEvalClampMax,            150,    101,    200) \
+  PARAM(timeReductionDepth,               9,      4,     12) \
+  PARAM(timeReductionA,                 192,    100,    200) \
+  PARAM(timeReductionB,                  95,     30,    120) \
+  PARAM(timeReductionC,                 147,    100,    180) \
+  PARAM(timeReductionD,                 232,    150,    250) \
+  PARAM(bestMoveInstabilityA,           200,    100,    250) \
+  PARAM(totalTimeGain,                   58,     30,    100) \
+  PARAM(optExtraA,                      100,     50,    150) \
+  PARAM(optExtraB,                      125,     50,    150) \
+  PARAM(optExtraC,                      100,     50,    150) \
+  PARAM(optConstantA,                   420,    100,    500) \
+  PARAM(optConstantB,                     0,      0,     50) \
+  PARAM(optConstantC,                    49,     10,    100) \
+  PARAM(maxConstantA,                   400,    100,    500) \
+  PARAM(maxConstantB,                     0,      0,    500) \
+  PARAM(maxConstantC,                   276,    100,    500) \
+  PARAM(optScaleA,                       84,     84,    200) \
+  PARAM(optScaleB,                       30,     20,     40) \
+  PARAM(optScaleC,                       50,     30,     60) \
+  PARAM(optScaleD,                       20,     10,     50) \
+  PARAM(maxScaleA,                       70,     50,    100) \
+  PARAM(maxScaleB,                      120,    100,    150) \
+  PARAM(maximumTimeA,                    80,     50,    150) \
+  PARAM(maximumTimeB,                     0,      0,     30)
+
+#ifdef TUNE
+
+// Each engine has its own set of parameter values, so that the two sides
+// of a selfplay match can differ. The search threads of an engine copy its
+// set into their thread-local variables before each task. Code that runs
+// outside of the search threads reads the engine's set with engine_param().
+
+#define PARAM(n, v, lo, hi) extern _Thread_local int n;
+PARAMS
+#undef PARAM
+
+struct Params {
+#define PARAM(n, v, lo, hi) int n;
+  PARAMS
+#undef PARAM
+};
+
+typedef struct Params Params;
+
+extern const Params DefaultParams;
+
+void params_load(const Params *p);
+bool params_set(Params *p, const char *name, int value);
+
+#define engine_param(e, n) ((e)->params.n)
+
+#else
+
+#define PARAM(n, v, lo, hi) enum { n = v };
+PARAMS
+#undef PARAM
+
+#define engine_param(e, n) (n)
+
+#endif
+
+#endif
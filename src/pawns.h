@@ -27,7 +27,8 @@
 #include "position.h"
 #include "types.h"
 
-// Number of entries in the pawn hash table. Must be a power of 2.
+// Default number of entries in the pawn hash table. The actual number is
+// set per engine and must be a power of 2.
 #define PAWN_ENTRIES 1024
 
 // PawnEntry contains various information about a pawn structure. A lookup
@@ -64,7 +65,7 @@ void pawn_entry_fill(const Position *pos, PawnEntry *e, Key k);
 INLINE PawnEntry *pawn_probe(const Position *pos)
 {
   Key key = pawn_key();
-  PawnEntry *e = &pos->pawnTable[key & (PAWN_ENTRIES - 1)];
+  PawnEntry *e = &pos->pawnTable[key & pos->pawnMask];
 
   if (unlikely(e->key != key))
     pawn_entry_fill(pos, e, key);
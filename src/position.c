@@ -4,6 +4,7 @@
 #include <string.h>
 
 #include "bitboard.h"
+#include "engine.h"
 #include "material.h"
 #include "misc.h"
 #include "movegen.h"
@@ -138,6 +139,14 @@ INLINE Key H2(Key h)
 static Key cuckoo[8192];
 static uint16_t cuckooMove[8192];
 
+// cuckoo_memory() returns the size in bytes of the cuckoo tables used to
+// detect upcoming repetitions.
+
+size_t cuckoo_memory(void)
+{
+  return sizeof(cuckoo) + sizeof(cuckooMove);
+}
+
 // zob_init() initializes at startup the various arrays used to compute
 // hash keys.
 
@@ -276,6 +285,9 @@ void pos_set(Position *pos, char *fen, int isChess960)
 
   pos->chess960 = isChess960;
   set_state(pos, st);
+#ifndef NNUE_PURE
+  st->changedBB = AllSquares;
+#endif
 
   assert(pos_is_ok(pos, &failed_step));
 }
@@ -356,6 +368,9 @@ static void set_state(Position *pos, Stack *st)
     st->materialKey += piece_count(WHITE, pt) * matKey[8 * WHITE + pt];
     st->materialKey += piece_count(BLACK, pt) * matKey[8 * BLACK + pt];
   }
+#ifndef NNUE_PURE
+  st->materialIndex = material_index(pos);
+#endif
 
   for (PieceType pt = KNIGHT; pt <= QUEEN; pt++)
     for (int c = 0; c < 2; c++)
@@ -608,13 +623,16 @@ bool is_pseudo_legal(const Position *pos, Move m)
   if (!(pieces_c(us) & sq_bb(from)))
     return false;
 
+  // A castling move is pseudo legal if we still have the right, the path
+  // between king and rook is free, we are not in check and the move is
+  // encoded exactly as generate_quiets() would encode it.
   if (unlikely(type_of_m(m) == CASTLING)) {
-    if (checkers()) return false;
-    ExtMove list[MAX_MOVES];
-    ExtMove *end = generate_quiets(pos, list);
-    for (ExtMove *p = list; p < end; p++)
-      if (p->move == m) return true;
-    return false;
+    if (checkers() || !(pieces_cp(us, KING) & sq_bb(from)))
+      return false;
+    int cr = make_castling_right(us, to_sq(m) > from ? KING_SIDE : QUEEN_SIDE);
+    return   can_castle_cr(cr)
+          && !castling_impeded(cr)
+          && m == make_castling(from, castling_rook_square(cr));
   }
 
   Square to = to_sq(m);
@@ -780,6 +798,9 @@ void do_move(Position *pos, Move m, int givesCheck)
   Piece piece = piece_on(from);
   Piece captured =  type_of_m(m) == ENPASSANT
                   ? make_piece(them, PAWN) : piece_on(to);
+#ifndef NNUE_PURE
+  Bitboard changed = 0; // Squares other than from and to
+#endif
 
   assert(color_of(piece) == us);
   assert(   is_empty(to)
@@ -815,6 +836,9 @@ void do_move(Position *pos, Move m, int givesCheck)
     st->psq += psqt.psq[captured][rto] - psqt.psq[captured][rfrom];
 #endif
     key ^= zob.psq[captured][rfrom] ^ zob.psq[captured][rto];
+#ifndef NNUE_PURE
+    changed = sq_bb(rfrom) | sq_bb(rto);
+#endif
     captured = 0;
   }
 
@@ -834,6 +858,9 @@ void do_move(Position *pos, Move m, int givesCheck)
         assert(piece_on(capsq) == make_piece(them, PAWN));
 
         pos->board[capsq] = 0; // Not done by remove_piece()
+#ifndef NNUE_PURE
+        changed = sq_bb(capsq);
+#endif
       }
 
 #ifndef NNUE_PURE
@@ -853,11 +880,15 @@ void do_move(Position *pos, Move m, int givesCheck)
     remove_piece(pos, them, captured, capsq);
     pos->pieceCount[captured]--;
 
-    // Update material hash key and prefetch access to materialTable
+    // Update material hash key and index and prefetch the material entry
     key ^= zob.psq[captured][capsq];
     st->materialKey -= matKey[captured];
 #ifndef NNUE_PURE
-    prefetch(&pos->materialTable[st->materialKey >> (64 - 13)]);
+    if (likely(st->materialIndex != MATERIAL_INDEX_NONE))
+      st->materialIndex -= MaterialIndexWeight[captured];
+    else
+      st->materialIndex = material_index(pos);
+    material_prefetch(pos);
 
     // Update incremental scores
     st->psq -= psqt.psq[captured][capsq];
@@ -872,6 +903,9 @@ void do_move(Position *pos, Move m, int givesCheck)
 
   // Update hash key
   key ^= zob.psq[piece][from] ^ zob.psq[piece][to];
+#ifndef NNUE_PURE
+  st->changedBB = changed | sq_bb(from) | sq_bb(to);
+#endif
 
   // Reset en passant square
   if (unlikely((st-1)->epSquare != 0))
@@ -936,6 +970,9 @@ void do_move(Position *pos, Move m, int givesCheck)
       st->materialKey += matKey[promotion] - matKey[piece];
 
 #ifndef NNUE_PURE
+      st->materialIndex = material_index(pos);
+      material_prefetch(pos);
+
       // Update incremental score
       st->psq += psqt.psq[promotion][to] - psqt.psq[piece][to];
 #endif
@@ -947,7 +984,7 @@ void do_move(Position *pos, Move m, int givesCheck)
 #ifndef NNUE_PURE
     // Update pawn hash key and prefetch access to pawnsTable
     st->pawnKey ^= zob.psq[piece][from] ^ zob.psq[piece][to];
-    prefetch2(&pos->pawnTable[st->pawnKey & (PAWN_ENTRIES -1)]);
+    prefetch2(&pos->pawnTable[st->pawnKey & pos->pawnMask]);
 #endif
 
     // Reset ply counters.
@@ -1078,7 +1115,10 @@ void do_null_move(Position *pos)
   }
 
   st->key ^= zob.side;
-  prefetch(tt_first_entry(st->key));
+  prefetch(tt_first_entry(&pos->engine->tt, st->key));
+#ifndef NNUE_PURE
+  st->changedBB = 0;
+#endif
 
   st->rule50++;
   st->pliesFromNull = 0;
@@ -30,6 +30,7 @@
 #include <string.h>
 
 #include "bitboard.h"
+#include "tt.h"
 #include "types.h"
 
 #ifdef NNUE
@@ -50,9 +51,19 @@ extern struct Zob zob;
 
 void psqt_init(void);
 void zob_init(void);
+size_t cuckoo_memory(void);
 
 // Stack struct stores information needed to restore a Position struct to
 // its previous state when we retract a move.
+//
+// In classical builds an entry is 264 bytes, grouped by use in cache lines.
+// The first line holds the state do_move() copies and updates. The second
+// holds the search data, including the fields the search reads back from
+// earlier plies (history, currentMove, staticEval, moveCount, statScore).
+// The rest holds the move picker state and the check info. A node uses all
+// of its own entry, so splitting the groups into parallel arrays would not
+// reduce the lines touched per ply. NNUE builds add the accumulator at the
+// end.
 
 struct Stack {
   // Copied when making a move
@@ -62,6 +73,7 @@ struct Stack {
   Key materialKey;
 #ifndef NNUE_PURE
   Score psq;
+  uint32_t materialIndex;
 #endif
   union {
     uint16_t nonPawnMaterial[2];
@@ -81,6 +93,9 @@ struct Stack {
   uint8_t epSquare;
   Key key;
   Bitboard checkersBB;
+#ifndef NNUE_PURE
+  Bitboard changedBB; // Squares whose contents the last move changed
+#endif
 
   // Original search stack data
   Move* pv;
@@ -101,6 +116,7 @@ struct Stack {
   uint8_t stage;
   uint8_t recaptureSquare;
   uint8_t mp_ply;
+  int8_t victim;
   Move countermove;
   Depth depth;
   Move ttMove;
@@ -130,6 +146,17 @@ struct Stack {
 
 typedef struct Stack Stack;
 
+#ifndef NNUE_PURE
+// SliderAttacks holds the slider attacks computed by the classical
+// evaluation for the position of one Stack entry, see slider_attacks().
+// They are kept apart from the Stack so that the search stack stays small.
+
+struct SliderAttacks {
+  Key key; // Key of the position attacks[] is valid for
+  Bitboard attacks[64];
+};
+#endif
+
 #define StateCopySize offsetof(Stack, capturedPiece)
 #define StateSize offsetof(Stack, pv)
 #define SStackBegin(st) (&st.pv)
@@ -164,6 +191,10 @@ struct Position {
   Stack *stack;
   uint64_t nodes;
   uint64_t tbHits;
+  uint64_t ttProbes, ttHits;
+#ifdef TT_STATS
+  TTStats ttStats;
+#endif
   uint64_t ttHitAverage;
   int pvIdx, pvLast;
   int selDepth, nmpMinPly;
@@ -179,10 +210,15 @@ struct Position {
   ButterflyHistory *mainHistory;
   CapturePieceToHistory *captureHistory;
   PawnEntry *pawnTable;
-  MaterialEntry *materialTable;
+  MaterialHashEntry *materialTable;
   CounterMoveHistoryStat *counterMoveHistory;
+  unsigned pawnMask;
+  int materialShift;
+  EvalCache *evalCache;
+  SliderAttacks *sliderAttacks; // One per Stack entry
 
   // Thread-control data.
+  Engine *engine;
   uint64_t bestMoveChanges;
   atomic_bool resetCalls;
   int callsCnt;
@@ -197,6 +233,7 @@ struct Position {
   HANDLE startEvent, stopEvent;
 #endif
   void *stackAllocation;
+  Game *game; // Game set up by position(), see uci.c
 };
 
 // FEN string input/output
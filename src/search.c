@@ -20,12 +20,15 @@
 #include <inttypes.h>
 #include <math.h>
 #include <stdio.h>
+#include <stdlib.h>
 #include <string.h>
 
 #include "evaluate.h"
 #include "misc.h"
 #include "movegen.h"
 #include "movepick.h"
+#include "engine.h"
+#include "params.h"
 #include "search.h"
 #include "settings.h"
 #include "timeman.h"
@@ -36,24 +39,17 @@
 #define load_rlx(x) atomic_load_explicit(&(x), memory_order_relaxed)
 #define store_rlx(x,y) atomic_store_explicit(&(x), y, memory_order_relaxed)
 
-LimitsType Limits;
-
-static int base_ct;
-
 // Different node types, used as template parameter
 enum { NonPV, PV };
 
 INLINE int futility_margin(Depth d, bool improving) {
-  return 165 * (d - improving);
+  return futilityMarginGain * (d - improving);
 }
 
-// Reductions lookup tables, initialized at startup
-static int Reductions[MAX_MOVES]; // [depth or moveNumber]
-
-INLINE Depth reduction(int i, Depth d, int mn, Value delta, Value rootDelta)
+INLINE Depth reduction(Position *pos, int i, Depth d, int mn, Value delta)
 {
-  int r = Reductions[d] * Reductions[mn];
-  return (r + 1642 - delta * 1024 / rootDelta) / 1024 + (!i && r > 916);
+  int r = pos->engine->reductions[d] * pos->engine->reductions[mn];
+  return (r + reductionA - delta * reductionB / pos->rootDelta) / 1024 + (!i && r > reductionC);
 }
 
 INLINE int futility_move_count(bool improving, Depth depth)
@@ -66,7 +62,7 @@ INLINE int futility_move_count(bool improving, Depth depth)
 static Value stat_bonus(Depth depth)
 {
   int d = depth;
-  return min((12 * d + 282) * d - 349 , 1594);
+  return min((statBonusA * d + statBonusB) * d - statBonusC, statBonusD);
 }
 
 // Add a small random component to draw evaluations to keep search dynamic
@@ -113,122 +109,217 @@ static void update_quiet_stats(const Position *pos, Stack *ss, Move move,
     int bonus);
 static void update_capture_stats(const Position *pos, Move move, Move *captures,
     int captureCnt, int bonus);
-static void check_time(void);
+static void check_time(Engine *e);
 static void stable_sort(RootMove *rm, int num);
 static void uci_print_pv(Position *pos, Depth depth, Value alpha, Value beta);
 static int extract_ponder_from_tt(RootMove *rm, Position *pos);
 
-// search_init() is called during startup to initialize various lookup tables
+// search_init() is called during startup and whenever the number of threads
+// changes to initialize the engine's reduction table.
 
-void search_init(void)
+void search_init(Engine *e)
 {
   for (int i = 1; i < MAX_MOVES; i++)
-    Reductions[i] = (21.84 + log(Threads.numThreads) / 2) * log(i);
+    e->reductions[i] = (  engine_param(e, reductionInit) / 100.0
+                        + log(e->threads.numThreads) / 2) * log(i);
 }
 
 
 // search_clear() resets search state to zero, to obtain reproducible results
 
-void search_clear(void)
+void search_clear(Engine *e)
 {
-  if (!settings.ttSize) {
+  if (!e->tt.table) {
     delayedSettings.clear = true;
     return;
   }
 
-  Time.availableNodes = 0;
+  e->time.availableNodes = 0;
 
-  tt_clear();
-  for (int i = 0; i < numCmhTables; i++)
-    if (cmhTables[i]) {
-      stats_clear(cmhTables[i]);
+  tt_clear(e);
+  for (int i = 0; i < e->numCmhTables; i++)
+    if (e->cmhTables[i]) {
+      stats_clear(e->cmhTables[i]);
       for (int j = 0; j < 7; j++)
         for (int k = 0; k < 64; k++)
-          (*cmhTables[i])[0][0][j][k] = CounterMovePruneThreshold - 1;
+          (*e->cmhTables[i])[0][0][j][k] =
+              engine_param(e, counterMoveHistoryThreshold);
     }
 
-  for (int idx = 0; idx < Threads.numThreads; idx++) {
-    Position *pos = Threads.pos[idx];
+  for (int idx = 0; idx < e->threads.numThreads; idx++) {
+    Position *pos = e->threads.pos[idx];
     stats_clear(pos->counterMoves);
     stats_clear(pos->mainHistory);
     stats_clear(pos->captureHistory);
   }
 
-  mainThread.previousScore = VALUE_INFINITE;
-  mainThread.previousTimeReduction = 1;
+  e->mainThread.previousScore = VALUE_INFINITE;
+  e->mainThread.previousTimeReduction = 1;
 }
 
 
 // perft() is our utility to verify move generation. All the leaf nodes
 // up to the given depth are generated and counted, and the sum is returned.
+// Moves at the last ply are not made but only counted (bulk counting). The
+// root moves are distributed over the search threads and, if the PerftHash
+// option is nonzero, subtree counts are cached in a small hash table.
 
-static uint64_t perft_helper(Position *pos, Depth depth);
-
-INLINE uint64_t perft_node(Position *pos, Depth depth, const bool Root)
+static uint64_t perft_helper(Position *pos, Depth depth)
 {
-  uint64_t cnt, nodes = 0;
-  const bool leaf = (depth == 2);
+  PerftState *ps = &pos->engine->perft;
+  uint64_t nodes = 0;
+  PerftEntry *e = NULL;
+  Key key = pos->st->key ^ (Key)depth;
+
+  if (ps->table && depth > 2) {
+    e = &ps->table[key & ps->mask];
+    if ((e->key ^ e->nodes) == key)
+      return e->nodes;
+  }
 
-  ExtMove *m = Root ? pos->moveList : (pos->st-1)->endMoves;
+  ExtMove *m = (pos->st-1)->endMoves;
   ExtMove *last = pos->st->endMoves = generate_legal(pos, m);
+
+  if (depth == 1)
+    return last - m;
+
   for (; m < last; m++) {
-    if (Root && depth <= 1) {
-      cnt = 1;
-      nodes++;
-    } else {
-      do_move(pos, m->move, gives_check(pos, pos->st, m->move));
-      cnt = leaf ? (uint64_t)(generate_legal(pos, last) - last)
-                 : perft_helper(pos, depth - 1);
-      nodes += cnt;
-      undo_move(pos, m->move);
-    }
-    if (Root) {
-      char buf[16];
-      printf("%s: %"PRIu64"\n", uci_move(buf, m->move, is_chess960()), cnt);
-    }
+    do_move(pos, m->move, gives_check(pos, pos->st, m->move));
+    nodes += depth == 2 ? (uint64_t)(generate_legal(pos, last) - last)
+                        : perft_helper(pos, depth - 1);
+    undo_move(pos, m->move);
   }
+
+  if (e) {
+    e->key = key ^ nodes;
+    e->nodes = nodes;
+  }
+
   return nodes;
 }
 
-static NOINLINE uint64_t perft_helper(Position *pos, Depth depth)
+// perft_worker() is run by each thread on receiving THREAD_PERFT. Threads
+// pick root moves until none are left.
+
+void perft_worker(Position *pos)
+{
+  PerftState *ps = &pos->engine->perft;
+  int i;
+
+  while ((i = atomic_fetch_add(&ps->next, 1)) < ps->numMoves) {
+    Move m = ps->moves[i].move;
+    pos->st->endMoves = pos->moveList;
+    do_move(pos, m, gives_check(pos, pos->st, m));
+    ps->nodes[i] = perft_helper(pos, ps->depth - 1);
+    undo_move(pos, m);
+  }
+}
+
+// copy_root() sets up a thread's position as a copy of the root position.
+
+static void copy_root(Position *pos, Position *root)
 {
-  return perft_node(pos, depth, false);
+  memcpy(pos, root, offsetof(Position, moveList));
+  // Copy enough of the root State buffer.
+  int n = max(7, root->st->pliesFromNull);
+  for (int i = 0; i <= n; i++)
+    memcpy(&pos->stack[i], &root->st[i - n], StateSize);
+  pos->st = pos->stack + n;
+  (pos->st-1)->endMoves = pos->moveList;
+#ifndef NNUE_PURE
+  // The root computes its slider attacks from scratch. The keys before it
+  // may have been cleared and its own key is flipped while its moves are
+  // searched, so neither can vouch for the attacks stored with them.
+  pos->st->changedBB = AllSquares;
+  pos->sliderAttacks[n].key = ~pos->st->key;
+#endif
+  pos_set_check_info(pos);
 }
 
-NOINLINE uint64_t perft(Position *pos, Depth depth)
+uint64_t perft(Position *pos, Depth depth, bool divide)
 {
-  return perft_node(pos, depth, true);
+  Engine *e = pos->engine;
+  PerftState *ps = &e->perft;
+  uint64_t nodes = 0;
+
+  if (e->threads.searching)
+    thread_wait_until_sleeping(threads_main(e));
+
+  // The tree of depth 0 is the root position itself, with no moves to list.
+  if (depth <= 0)
+    return 1;
+
+  ps->numMoves = generate_legal(pos, ps->moves) - ps->moves;
+  ps->depth = depth;
+  atomic_store(&ps->next, 0);
+
+  size_t mb = option_value(OPT_PERFT_HASH);
+  if (mb && depth > 3) {
+    size_t entries = 1;
+    while (2 * entries * sizeof(PerftEntry) <= (mb << 20))
+      entries *= 2;
+    ps->table = calloc(entries, sizeof(PerftEntry));
+    ps->mask = entries - 1;
+  }
+
+  if (depth <= 1)
+    for (int i = 0; i < ps->numMoves; i++)
+      ps->nodes[i] = 1;
+  else {
+    for (int idx = 0; idx < e->threads.numThreads; idx++)
+      copy_root(e->threads.pos[idx], pos);
+    for (int idx = 0; idx < e->threads.numThreads; idx++)
+      thread_wake_up(e->threads.pos[idx], THREAD_PERFT);
+    for (int idx = 0; idx < e->threads.numThreads; idx++)
+      thread_wait_until_sleeping(e->threads.pos[idx]);
+  }
+
+  for (int i = 0; i < ps->numMoves; i++) {
+    if (divide) {
+      char buf[16];
+      printf("%s: %"PRIu64"\n", uci_move(buf, ps->moves[i].move,
+                                         is_chess960()), ps->nodes[i]);
+    }
+    nodes += ps->nodes[i];
+  }
+
+  free(ps->table);
+  ps->table = NULL;
+
+  return nodes;
 }
 
 // mainthread_search() is called by the main thread when the program
 // receives the UCI 'go' command. It searches from the root position and
 // outputs the "bestmove".
 
-void mainthread_search(void)
+void mainthread_search(Position *pos)
 {
-  Position *pos = Threads.pos[0];
+  Engine *e = pos->engine;
   Color us = stm();
-  time_init(us, game_ply());
-  tt_new_search();
+  time_init(e, us, game_ply());
+  tt_new_search(&e->tt);
   char buf[16];
   bool playBookMove = false;
 
 #ifdef NNUE
-  switch (useNNUE) {
-  case EVAL_HYBRID:
-    printf("info string Hybrid NNUE evaluation using %s enabled.\n", option_string_value(OPT_EVAL_FILE));
-    break;
-  case EVAL_PURE:
-    printf("info string Pure NNUE evaluation using %s enabled.\n", option_string_value(OPT_EVAL_FILE));
-    break;
-  case EVAL_CLASSICAL:
-    printf("info string Classical evaluation enabled.\n");
-    break;
+  if (!e->silent) {
+    switch (useNNUE) {
+    case EVAL_HYBRID:
+      printf("info string Hybrid NNUE evaluation using %s enabled.\n", option_string_value(OPT_EVAL_FILE));
+      break;
+    case EVAL_PURE:
+      printf("info string Pure NNUE evaluation using %s enabled.\n", option_string_value(OPT_EVAL_FILE));
+      break;
+    case EVAL_CLASSICAL:
+      printf("info string Classical evaluation enabled.\n");
+      break;
+    }
   }
 #endif
 
   // base_ct = option_value(OPT_CONTEMPT) * PawnValueEg / 100;
-  base_ct = 24 * PawnValueEg / 100;
+  e->baseCt = 24 * PawnValueEg / 100;
 
   // const char *s = option_string_value(OPT_ANALYSIS_CONTEMPT);
   // if (Limits.infinite || option_value(OPT_ANALYSE_MODE))
@@ -251,10 +342,10 @@ void mainthread_search(void)
       }
 
     if (!playBookMove) {
-      Threads.pos[0]->bestMoveChanges = 0;
-      for (int idx = 1; idx < Threads.numThreads; idx++) {
-        Threads.pos[idx]->bestMoveChanges = 0;
-        thread_wake_up(Threads.pos[idx], THREAD_SEARCH);
+      e->threads.pos[0]->bestMoveChanges = 0;
+      for (int idx = 1; idx < e->threads.numThreads; idx++) {
+        e->threads.pos[idx]->bestMoveChanges = 0;
+        thread_wake_up(e->threads.pos[idx], THREAD_SEARCH);
       }
 
       thread_search(pos); // Let's start searching!
@@ -267,52 +358,54 @@ void mainthread_search(void)
   // move before the GUI sends a "stop" or "ponderhit" command. We
   // therefore simply wait here until the GUI sends one of those commands
   // (which also raises Threads.stop).
-  LOCK(Threads.lock);
-  if (!Threads.stop && (Threads.ponder || Limits.infinite)) {
-    Threads.sleeping = true;
-    UNLOCK(Threads.lock);
-    thread_wait(pos, &Threads.stop);
+  LOCK(e->threads.lock);
+  if (!e->threads.stop && (e->threads.ponder || e->limits.infinite)) {
+    e->threads.sleeping = true;
+    UNLOCK(e->threads.lock);
+    thread_wait(pos, &e->threads.stop);
   } else
-    UNLOCK(Threads.lock);
+    UNLOCK(e->threads.lock);
 
   // Stop the other threads if they have not stopped already
-  Threads.stop = true;
+  e->threads.stop = true;
 
   // Wait until all threads have finished
   if (pos->rootMoves->size > 0) {
     if (!playBookMove) {
-      for (int idx = 1; idx < Threads.numThreads; idx++)
-        thread_wait_until_sleeping(Threads.pos[idx]);
+      for (int idx = 1; idx < e->threads.numThreads; idx++)
+        thread_wait_until_sleeping(e->threads.pos[idx]);
     }
   } else {
     pos->rootMoves->move[0].pv[0] = 0;
     pos->rootMoves->move[0].pvSize = 1;
     pos->rootMoves->size++;
-    printf("info depth 0 score %s\n",
-           uci_value(buf, checkers() ? -VALUE_MATE : VALUE_DRAW));
-    fflush(stdout);
+    if (!e->silent) {
+      printf("info depth 0 score %s\n",
+             uci_value(buf, checkers() ? -VALUE_MATE : VALUE_DRAW));
+      fflush(stdout);
+    }
   }
 
   // When playing in 'nodes as time' mode, subtract the searched nodes from
   // the available ones before exiting.
-  if (Limits.npmsec)
-    Time.availableNodes += Limits.inc[us] - threads_nodes_searched();
+  if (e->limits.npmsec)
+    e->time.availableNodes += e->limits.inc[us] - threads_nodes_searched(e);
 
   // Check if there are threads with a better score than main thread
   Position *bestThread = pos;
   if (   !playBookMove
-      && !Limits.depth
+      && !e->limits.depth
 //      && !Skill(option_value(OPT_SKILL_LEVEL)).enabled()
       &&  pos->rootMoves->move[0].pv[0] != 0)
   {
-    int i, num = 0, maxNum = min(pos->rootMoves->size, Threads.numThreads);
+    int i, num = 0, maxNum = min(pos->rootMoves->size, e->threads.numThreads);
     Move mvs[maxNum];
     int64_t votes[maxNum];
     Value minScore = pos->rootMoves->move[0].score;
-    for (int idx = 1; idx < Threads.numThreads; idx++)
-      minScore = min(minScore, Threads.pos[idx]->rootMoves->move[0].score);
-    for (int idx = 0; idx < Threads.numThreads; idx++) {
-      Position *p = Threads.pos[idx];
+    for (int idx = 1; idx < e->threads.numThreads; idx++)
+      minScore = min(minScore, e->threads.pos[idx]->rootMoves->move[0].score);
+    for (int idx = 0; idx < e->threads.numThreads; idx++) {
+      Position *p = e->threads.pos[idx];
       Move m = p->rootMoves->move[0].pv[0];
       for (i = 0; i < num; i++)
         if (mvs[i] == m) break;
@@ -324,8 +417,8 @@ void mainthread_search(void)
       votes[i] += (p->rootMoves->move[0].score - minScore + 14) * p->completedDepth;
     }
     int64_t bestVote = votes[0];
-    for (int idx = 1; idx < Threads.numThreads; idx++) {
-      Position *p = Threads.pos[idx];
+    for (int idx = 1; idx < e->threads.numThreads; idx++) {
+      Position *p = e->threads.pos[idx];
       for (i = 0; mvs[i] != p->rootMoves->move[0].pv[0]; i++);
       if (abs(bestThread->rootMoves->move[0].score) >= VALUE_TB_WIN_IN_MAX_PLY) {
         // Make sure we pick the shortest mate
@@ -341,7 +434,10 @@ void mainthread_search(void)
     }
   }
 
-  mainThread.previousScore = bestThread->rootMoves->move[0].score;
+  e->mainThread.previousScore = bestThread->rootMoves->move[0].score;
+
+  if (e->silent)
+    return;
 
   // Send new PV when needed
   // if (bestThread != pos)
@@ -368,6 +464,7 @@ void mainthread_search(void)
 
 void thread_search(Position *pos)
 {
+  Engine *e = pos->engine;
   Value bestValue, alpha, beta, delta;
   Move pv[MAX_PLY + 1];
   Move lastBestMove = 0;
@@ -400,12 +497,12 @@ void thread_search(Position *pos)
   pos->completedDepth = 0;
 
   if (pos->threadIdx == 0) {
-    if (mainThread.previousScore == VALUE_INFINITE)
+    if (e->mainThread.previousScore == VALUE_INFINITE)
       for (int i = 0; i < 4; i++)
-        mainThread.iterValue[i] = VALUE_ZERO;
+        e->mainThread.iterValue[i] = VALUE_ZERO;
     else
       for (int i = 0; i < 4; i++)
-        mainThread.iterValue[i] = mainThread.previousScore;
+        e->mainThread.iterValue[i] = e->mainThread.previousScore;
   }
 
   // int multiPV = option_value(OPT_MULTI_PV);
@@ -426,10 +523,10 @@ void thread_search(Position *pos)
   // Iterative deepening loop until requested to stop or the target depth
   // is reached.
   while (   ++pos->rootDepth < MAX_PLY
-         && !Threads.stop
-         && !(   Limits.depth
+         && !e->threads.stop
+         && !(   e->limits.depth
               && pos->threadIdx == 0
-              && pos->rootDepth > Limits.depth))
+              && pos->rootDepth > e->limits.depth))
   {
     // Age out PV variability metric
     if (pos->threadIdx == 0)
@@ -440,16 +537,16 @@ void thread_search(Position *pos)
     for (int idx = 0; idx < rm->size; idx++)
       rm->move[idx].previousScore = rm->move[idx].score;
 
-    pos->contempt = stm() == WHITE ?  make_score(base_ct, base_ct / 2)
-                                   : -make_score(base_ct, base_ct / 2);
+    pos->contempt = stm() == WHITE ?  make_score(e->baseCt, e->baseCt / 2)
+                                   : -make_score(e->baseCt, e->baseCt / 2);
 
     int pvFirst = 0, pvLast = 0;
 
-    if (!Threads.increaseDepth)
+    if (!e->threads.increaseDepth)
       searchAgainCounter++;
 
     // MultiPV loop. We perform a full root search for each PV line
-    for (int pvIdx = 0; pvIdx < multiPV && !Threads.stop; pvIdx++) {
+    for (int pvIdx = 0; pvIdx < multiPV && !e->threads.stop; pvIdx++) {
       pos->pvIdx = pvIdx;
       if (pvIdx == pvLast) {
         pvFirst = pvLast;
@@ -472,13 +569,13 @@ void thread_search(Position *pos)
       // Reset aspiration window starting size
       if (pos->rootDepth >= 4) {
         Value prev = rm->move[pvIdx].averageScore;
-        delta = 13 + prev * prev / 15753;
+        delta = aspirationDeltaA + prev * prev / aspirationDeltaB;
         alpha = max(prev - delta, -VALUE_INFINITE);
         beta  = min(prev + delta,  VALUE_INFINITE);
 
         // Adjust contempt based on root move's previousScore
         Value previousScore = rm->move[pvIdx].previousScore;
-        int ct = base_ct + (113 - base_ct / 2) * previousScore / (abs(previousScore) + 147);
+        int ct = e->baseCt + (113 - e->baseCt / 2) * previousScore / (abs(previousScore) + 147);
         pos->contempt = stm() == WHITE ?  make_score(ct, ct / 2)
                                        : -make_score(ct, ct / 2);
       }
@@ -502,7 +599,7 @@ void thread_search(Position *pos)
         // If search has been stopped, we break immediately. Sorting and
         // writing PV back to TT is safe because RootMoves is still
         // valid, although it refers to the previous iteration.
-        if (Threads.stop)
+        if (e->threads.stop)
           break;
 
         // When failing high/low give some update (without cluttering
@@ -521,14 +618,14 @@ void thread_search(Position *pos)
 
           pos->failedHighCnt = 0;
           if (pos->threadIdx == 0)
-            Threads.stopOnPonderhit = false;
+            e->threads.stopOnPonderhit = false;
         } else if (bestValue >= beta) {
           beta = min(bestValue + delta, VALUE_INFINITE);
           pos->failedHighCnt++;
         } else
           break;
 
-        delta += delta / 4 + 2;
+        delta += delta / aspirationDeltaC + aspirationDeltaD;
 
         assert(alpha >= -VALUE_INFINITE && beta <= VALUE_INFINITE);
       }
@@ -542,7 +639,7 @@ skip_search:
       //   uci_print_pv(pos, pos->rootDepth, alpha, beta);
     }
 
-    if (!Threads.stop)
+    if (!e->threads.stop)
       pos->completedDepth = pos->rootDepth;
 
     if (rm->move[0].pv[0] != lastBestMove) {
@@ -551,10 +648,10 @@ skip_search:
     }
 
     // Have we found a "mate in x"?
-    if (   Limits.mate
+    if (   e->limits.mate
         && bestValue >= VALUE_MATE_IN_MAX_PLY
-        && VALUE_MATE - bestValue <= 2 * Limits.mate)
-      Threads.stop = true;
+        && VALUE_MATE - bestValue <= 2 * e->limits.mate)
+      e->threads.stop = true;
 
     if (pos->threadIdx != 0)
       continue;
@@ -566,58 +663,58 @@ skip_search:
 #endif
 
     // Do we have time for the next iteration? Can we stop searching now?
-    if (    use_time_management()
-        && !Threads.stop
-        && !Threads.stopOnPonderhit)
+    if (    use_time_management(e)
+        && !e->threads.stop
+        && !e->threads.stopOnPonderhit)
     {
-      double fallingEval = (318 + 6 * (mainThread.previousScore - bestValue)
-                                + 6 * (mainThread.iterValue[iterIdx] - bestValue)) / 825.0;
-      fallingEval = clamp(fallingEval, 0.5, 1.5);
+      double fallingEval = (fallingEvalA + fallingEvalB * (e->mainThread.previousScore - bestValue)
+                                         + fallingEvalC * (e->mainThread.iterValue[iterIdx] - bestValue)) / (double)fallingEvalD;
+      fallingEval = clamp(fallingEval, fallingEvalClampMin / 100.0, fallingEvalClampMax / 100.0);
 
       // If the best move is stable over several iterations, reduce time
       // accordingly
-      timeReduction = lastBestMoveDepth + 9 < pos->completedDepth ? 1.92 : 0.95;
-      double reduction = (1.47 + mainThread.previousTimeReduction) / (2.32 * timeReduction);
+      timeReduction = lastBestMoveDepth + timeReductionDepth < pos->completedDepth ? timeReductionA / 100.0 : timeReductionB / 100.0;
+      double reduction = (timeReductionC / 100.0 + e->mainThread.previousTimeReduction) / (timeReductionD / 100.0 * timeReduction);
 
       // Use part of the gained time from a previous stable move for this move
-      for (int i = 0; i < Threads.numThreads; i++) {
-        totBestMoveChanges += Threads.pos[i]->bestMoveChanges;
-        Threads.pos[i]->bestMoveChanges = 0;
+      for (int i = 0; i < e->threads.numThreads; i++) {
+        totBestMoveChanges += e->threads.pos[i]->bestMoveChanges;
+        e->threads.pos[i]->bestMoveChanges = 0;
       }
 
-      double bestMoveInstability = 1 + 2 * totBestMoveChanges / Threads.numThreads;
+      double bestMoveInstability = 1 + bestMoveInstabilityA / 100.0 * totBestMoveChanges / e->threads.numThreads;
 
-      double totalTime = time_optimum() * fallingEval * reduction * bestMoveInstability;
+      double totalTime = time_optimum(e) * fallingEval * reduction * bestMoveInstability;
 
       // In the case of a single legal move, cap total time to 500ms.
       if (rm->size == 1)
         totalTime = min(500.0, totalTime);
 
       // Stop the search if we have exceeded the totalTime
-      if (time_elapsed() > totalTime) {
+      if (time_elapsed(e) > totalTime) {
         // If we are allowed to ponder do not stop the search now but
         // keep pondering until the GUI sends "ponderhit" or "stop".
-        if (Threads.ponder)
-          Threads.stopOnPonderhit = true;
+        if (e->threads.ponder)
+          e->threads.stopOnPonderhit = true;
         else
-          Threads.stop = true;
+          e->threads.stop = true;
       }
-      else if (   Threads.increaseDepth
-               && !Threads.ponder
-               && time_elapsed() > totalTime * 0.58)
-        Threads.increaseDepth = false;
+      else if (   e->threads.increaseDepth
+               && !e->threads.ponder
+               && time_elapsed(e) > totalTime * (totalTimeGain / 100.0))
+        e->threads.increaseDepth = false;
       else
-        Threads.increaseDepth = true;
+        e->threads.increaseDepth = true;
     }
 
-    mainThread.iterValue[iterIdx] = bestValue;
+    e->mainThread.iterValue[iterIdx] = bestValue;
     iterIdx = (iterIdx + 1) & 3;
   }
 
   if (pos->threadIdx != 0)
     return;
 
-  mainThread.previousTimeReduction = timeReduction;
+  e->mainThread.previousTimeReduction = timeReduction;
 
 #if 0
   // If skill level is enabled, swap best PV line with the sub-optimal one
@@ -632,6 +729,7 @@ skip_search:
 INLINE Value search_node(Position *pos, Stack *ss, Value alpha, Value beta,
     Depth depth, bool cutNode, const int NT)
 {
+  Engine *e = pos->engine;
   const bool PvNode = NT == PV;
   const bool rootNode = PvNode && ss->ply == 0;
   const Depth maxNextDepth = rootNode ? depth : depth + 1;
@@ -664,7 +762,7 @@ INLINE Value search_node(Position *pos, Stack *ss, Value alpha, Value beta,
   assert(!(PvNode && cutNode));
 
   Move pv[MAX_PLY+1], capturesSearched[32], quietsSearched[64];
-  TTEntry *tte;
+  TTEntry *tte, *ttd, ttData;
   Key posKey;
   Move ttMove, move, excludedMove, bestMove;
   Depth extension, newDepth;
@@ -684,13 +782,13 @@ INLINE Value search_node(Position *pos, Stack *ss, Value alpha, Value beta,
   // Check for the available remaining time
   if (load_rlx(pos->resetCalls)) {
     store_rlx(pos->resetCalls, false);
-    pos->callsCnt = Limits.nodes ? min(1024, Limits.nodes / 1024) : 1024;
+    pos->callsCnt = e->limits.nodes ? min(1024, e->limits.nodes / 1024) : 1024;
   }
   if (--pos->callsCnt <= 0) {
-    for (int idx = 0; idx < Threads.numThreads; idx++)
-      store_rlx(Threads.pos[idx]->resetCalls, true);
+    for (int idx = 0; idx < e->threads.numThreads; idx++)
+      store_rlx(e->threads.pos[idx]->resetCalls, true);
 
-    check_time();
+    check_time(e);
   }
 
   // Used to send selDepth info to GUI
@@ -699,7 +797,7 @@ INLINE Value search_node(Position *pos, Stack *ss, Value alpha, Value beta,
 
   if (!rootNode) {
     // Step 2. Check for aborted search and immediate draw
-    if (load_rlx(Threads.stop) || is_draw(pos) || ss->ply >= MAX_PLY)
+    if (load_rlx(e->threads.stop) || is_draw(pos) || ss->ply >= MAX_PLY)
       return  ss->ply >= MAX_PLY && !inCheck ? evaluate(pos)
                                              : value_draw(pos);
 
@@ -748,21 +846,29 @@ INLINE Value search_node(Position *pos, Stack *ss, Value alpha, Value beta,
   // use a different position key in case of an excluded move.
   excludedMove = ss->excludedMove;
   posKey = !excludedMove ? key() : key() ^ make_key(excludedMove);
-  tte = tt_probe(posKey, &ss->ttHit);
-  ttValue = ss->ttHit ? value_from_tt(tte_value(tte), ss->ply, rule50_count()) : VALUE_NONE;
+  tte = tt_probe(&e->tt, posKey, &ss->ttHit, &ttData);
+  ttd = tt_data(tte, &ttData);
+  pos->ttProbes++;
+  pos->ttHits += ss->ttHit;
+  ttValue = ss->ttHit ? value_from_tt(tte_value(ttd), ss->ply, rule50_count()) : VALUE_NONE;
   ttMove =  rootNode ? pos->rootMoves->move[pos->pvIdx].pv[0]
-          : ss->ttHit    ? tte_move(tte) : 0;
+          : ss->ttHit    ? tte_move(ttd) : 0;
+#ifdef TT_STATS
+  tt_stats_probe(&pos->ttStats, &e->tt, ttd, ss->ttHit);
+  if (!rootNode && ttMove && !is_pseudo_legal(pos, ttMove))
+    pos->ttStats.falseHits++;
+#endif
   ttCapture = ttMove && is_capture(pos, ttMove);
   if (!excludedMove)
-    ss->ttPv = PvNode || (ss->ttHit && tte_is_pv(tte));
+    ss->ttPv = PvNode || (ss->ttHit && tte_is_pv(ttd));
 
   // At non-PV nodes we check for an early TT cutoff.
   if (  !PvNode
       && ss->ttHit
-      && tte_depth(tte) > depth - (tte_bound(tte) == BOUND_EXACT)
+      && tte_depth(ttd) > depth - (tte_bound(ttd) == BOUND_EXACT)
       && ttValue != VALUE_NONE // Possible in case of TT access race.
-      && (ttValue >= beta ? (tte_bound(tte) & BOUND_LOWER)
-                          : (tte_bound(tte) & BOUND_UPPER)))
+      && (ttValue >= beta ? (tte_bound(ttd) & BOUND_LOWER)
+                          : (tte_bound(ttd) & BOUND_UPPER)))
   {
     // If ttMove is quiet, update move sorting heuristics on TT hit.
     if (ttMove) {
@@ -781,8 +887,12 @@ INLINE Value search_node(Position *pos, Stack *ss, Value alpha, Value beta,
         update_cm_stats(ss, moved_piece(ttMove), to_sq(ttMove), penalty);
       }
     }
-    if (rule50_count() < 90)
+    if (rule50_count() < 90) {
+#ifdef TT_STATS
+      pos->ttStats.cutoffs++;
+#endif
       return ttValue;
+    }
   }
 
   // Step 6. Static evaluation of the position
@@ -795,7 +905,7 @@ INLINE Value search_node(Position *pos, Stack *ss, Value alpha, Value beta,
     goto moves_loop;
   } else if (ss->ttHit) {
     // Never assume anything about values stored in TT
-    ss->staticEval = eval = tte_eval(tte);
+    ss->staticEval = eval = tte_eval(ttd);
     Value psq = eg_value(psq_score());
     if (eval == VALUE_NONE) {
       ss->staticEval = eval = evaluate(pos);
@@ -806,7 +916,7 @@ INLINE Value search_node(Position *pos, Stack *ss, Value alpha, Value beta,
 
     // Can ttValue be used as a better position evaluation?
     if (   ttValue != VALUE_NONE
-        && (tte_bound(tte) & (ttValue > eval ? BOUND_LOWER : BOUND_UPPER)))
+        && (tte_bound(ttd) & (ttValue > eval ? BOUND_LOWER : BOUND_UPPER)))
       eval = ttValue;
   } else {
     ss->staticEval = eval = evaluate(pos);
@@ -814,7 +924,7 @@ INLINE Value search_node(Position *pos, Stack *ss, Value alpha, Value beta,
     complexity = abs(eval - psq);
 
     if (!excludedMove)
-      tte_save(tte, posKey, VALUE_NONE, ss->ttPv, BOUND_NONE, DEPTH_NONE, 0,
+      tte_save(&e->tt, tte, posKey, VALUE_NONE, ss->ttPv, BOUND_NONE, DEPTH_NONE, 0,
           eval);
   }
 
@@ -822,19 +932,20 @@ INLINE Value search_node(Position *pos, Stack *ss, Value alpha, Value beta,
       && !(ss-1)->checkersBB
       && !captured_piece())
   {
-    int bonus = clamp(-0 * ((ss-1)->staticEval + ss->staticEval), -1870, 1870);
+    int bonus = clamp(bonusInitialGain * ((ss-1)->staticEval + ss->staticEval),
+                      -bonusInitialThreshold, bonusInitialThreshold);
     history_update(*pos->mainHistory, !stm(), (ss-1)->currentMove, bonus);
   }
 
   improvement =   (ss-2)->staticEval != VALUE_NONE ? ss->staticEval - (ss-2)->staticEval
                 : (ss-4)->staticEval != VALUE_NONE ? ss->staticEval - (ss-4)->staticEval
-                :                                    125;
+                :                                    improvementDefault;
   improving = improvement > 0;
 
   // Step 6.5. Razoring.
   // If eval is really low check with qsearch if it can exceed alpha, if it can't,
   // return a fail low.
-  if (eval < alpha - 406 - 280 * depth * depth)
+  if (eval < alpha + razoringA + razoringB * depth * depth)
   {
       value = inCheck ? qsearch_NonPV_true(pos, ss, alpha, 0)
                       : qsearch_NonPV_false(pos, ss, alpha, 0);
@@ -844,8 +955,8 @@ INLINE Value search_node(Position *pos, Stack *ss, Value alpha, Value beta,
 
   // Step 7. Futility pruning: child node
   if (   !PvNode
-      &&  depth < 8
-      &&  eval - futility_margin(depth, improving) - (ss-1)->statScore / 338 >= beta
+      &&  depth < futilityDepth
+      &&  eval - futility_margin(depth, improving) - (ss-1)->statScore / futilityA >= beta
       &&  eval >= beta
       &&  eval < 28031)  // Do not return unproven wins
     return eval; // - futility_margin(depth); (do not do the right thing)
@@ -853,10 +964,10 @@ INLINE Value search_node(Position *pos, Stack *ss, Value alpha, Value beta,
   // Step 8. Null move search with verification search (is omitted in PV nodes)
   if (   !PvNode
       && (ss-1)->currentMove != MOVE_NULL
-      && (ss-1)->statScore < 16227
+      && (ss-1)->statScore < nullMoveThreshA
       && eval >= beta
       && eval >= ss->staticEval
-      && ss->staticEval >= beta - 29 * depth - improvement / 12 + 213 + complexity / 23
+      && ss->staticEval >= beta + nullMoveThreshB * depth - improvement / nullMoveThreshC + nullMoveThreshD + complexity / nullMoveThreshE
       && !excludedMove
       && non_pawn_material_c(stm())
       && (ss->ply >= pos->nmpMinPly || stm() != pos->nmpColor))
@@ -864,7 +975,7 @@ INLINE Value search_node(Position *pos, Stack *ss, Value alpha, Value beta,
     assert(eval - beta >= 0);
 
     // Null move dynamic reduction based on depth and value
-    Depth R = min((eval - beta) / 151, 7) + depth / 3 + 4 - (complexity > 781);
+    Depth R = min((eval - beta) / nullMoveRA, nullMoveRB) + depth / nullMoveRC + nullMoveRD - (complexity > nullMoveRE);
 
     ss->currentMove = MOVE_NULL;
     ss->history = &(*pos->counterMoveHistory)[0][0];
@@ -879,14 +990,14 @@ INLINE Value search_node(Position *pos, Stack *ss, Value alpha, Value beta,
       if (nullValue >= VALUE_TB_WIN_IN_MAX_PLY)
         nullValue = beta;
 
-      if (pos->nmpMinPly || (abs(beta) < VALUE_KNOWN_WIN && depth < 13))
+      if (pos->nmpMinPly || (abs(beta) < VALUE_KNOWN_WIN && depth < nullMoveDepth))
         return nullValue;
 
       assert(!pos->nmpMinPly);
 
       // Do verification search at high depths with null move pruning
       // disabled for us, until ply exceeds nmpMinPly.
-      pos->nmpMinPly = ss->ply + 2 * (depth-R) / 3;
+      pos->nmpMinPly = ss->ply + nullMovePlyA * (depth-R) / nullMovePlyB;
       pos->nmpColor = stm();
 
       Value v = search_NonPV(pos, ss, beta-1, depth-R, false);
@@ -898,23 +1009,23 @@ INLINE Value search_node(Position *pos, Stack *ss, Value alpha, Value beta,
     }
   }
 
-  probCutBeta = beta + 185 - 56 * improving;
+  probCutBeta = beta + probCutBetaA - probCutBetaB * improving;
 
   // Step 9. ProbCut
   // If we have a good enough capture and a reduced search returns a value
   // much above beta, we can (almost) safely prune the previous move.
   if (   !PvNode
-      &&  depth > 4
+      &&  depth > probCutDepthLimit
       &&  abs(beta) < VALUE_TB_WIN_IN_MAX_PLY
       && !(   ss->ttHit
-           && tte_depth(tte) >= depth - 4
+           && tte_depth(ttd) >= depth - probCutDepth
            && ttValue != VALUE_NONE
            && ttValue < probCutBeta))
   {
     mp_init_pc(pos, ttMove, probCutBeta - ss->staticEval);
 
     while (  (move = next_move(pos, 0)))
-      if (move != excludedMove && is_legal(pos, move)) {
+      if (move != excludedMove) {
         assert(is_capture(pos, move));
 
         ss->currentMove = move;
@@ -933,7 +1044,7 @@ INLINE Value search_node(Position *pos, Stack *ss, Value alpha, Value beta,
 
         undo_move(pos, move);
         if (value >= probCutBeta) {
-          tte_save(tte, posKey, value_to_tt(value, ss->ply), ss->ttPv,
+          tte_save(&e->tt, tte, posKey, value_to_tt(value, ss->ply), ss->ttPv,
               BOUND_LOWER, depth - 4, move, ss->staticEval);
           return value;
         }
@@ -942,25 +1053,25 @@ INLINE Value search_node(Position *pos, Stack *ss, Value alpha, Value beta,
 
   // Step 10. If the position is not in TT, decrease depth by 2
   if (PvNode && !ttMove)
-    depth -= 3;
+    depth -= ttDecreaseA;
   if (depth <= 0)
     return inCheck ? qsearch_PV_true(pos, ss, alpha, beta, 0)
                    : qsearch_PV_false(pos, ss, alpha, beta, 0);
-  if (cutNode && depth >= 9 && !ttMove)
-    depth -= 1;
+  if (cutNode && depth >= ttDecreaseDepth && !ttMove)
+    depth -= ttDecreaseB;
 
 moves_loop: // When in check search starts from here
 
   ttCapture = ttMove && is_capture(pos, ttMove);
 
   // Step 11. A small Probcut idea, when we are in check
-  probCutBeta = beta + 413;
+  probCutBeta = beta + probCutBetaC;
   if (   inCheck
       && !PvNode
-      && depth >= 2
+      && depth >= probCutDepthThresh
       && ttCapture
-      && (tte_bound(tte) & BOUND_LOWER)
-      && tte_depth(tte) >= depth - 3
+      && (tte_bound(ttd) & BOUND_LOWER)
+      && tte_depth(ttd) >= depth - 3
       && ttValue >= probCutBeta
       && abs(ttValue) <= VALUE_KNOWN_WIN
       && abs(beta) <= VALUE_KNOWN_WIN
@@ -982,8 +1093,8 @@ moves_loop: // When in check search starts from here
   // result of the search was far below alpha
   bool likelyFailLow =   PvNode
                       && ttMove
-                      && (tte_bound(tte) & BOUND_UPPER)
-                      && tte_depth(tte) >= depth;
+                      && (tte_bound(ttd) & BOUND_UPPER)
+                      && tte_depth(ttd) >= depth;
 
   // Step 12. Loop through moves
   // Loop through all pseudo-legal moves until no moves remain or a beta
@@ -1007,9 +1118,7 @@ moves_loop: // When in check search starts from here
         continue;
     }
 
-    // Check for legality just before making the move
-    if (!rootNode && !is_legal(pos, move))
-      continue;
+    assert(is_legal(pos, move));
 
     ss->moveCount = ++moveCount;
 
@@ -1045,7 +1154,7 @@ moves_loop: // When in check search starts from here
       moveCountPruning = moveCount >= futility_move_count(improving, depth);
 
       // Reduced depth of the next LMR search
-      int lmrDepth = max(newDepth - reduction(improving, depth, moveCount, delta, pos->rootDelta), 0);
+      int lmrDepth = max(newDepth - reduction(pos, improving, depth, moveCount, delta), 0);
 
       if (   captureOrPromotion
           || givesCheck)
@@ -1053,14 +1162,14 @@ moves_loop: // When in check search starts from here
         // Capture history based pruning when the move doesn't give check
         if (   !givesCheck
             && !PvNode
-            && lmrDepth < 8
+            && lmrDepth < shallowPruningDepthA
             && !inCheck
-            && ss->staticEval + 192 + 205 * lmrDepth + PieceValue[EG][piece_on(to_sq(move))]
-              + (*pos->captureHistory)[movedPiece][to_sq(move)][type_of_p(piece_on(to_sq(move)))] / 7 < alpha)
+            && ss->staticEval + shallowPruningA + shallowPruningB * lmrDepth + PieceValue[EG][piece_on(to_sq(move))]
+              + (*pos->captureHistory)[movedPiece][to_sq(move)][type_of_p(piece_on(to_sq(move)))] / shallowPruningC < alpha)
           continue;
 
         // SEE based pruning
-        if (!see_test(pos, move, -201 * depth))
+        if (!see_test(pos, move, sseThreshold * depth))
           continue;
 
       } else {
@@ -1068,21 +1177,21 @@ moves_loop: // When in check search starts from here
                     + (*fmh)[movedPiece][to_sq(move)]
                     + (*fmh2)[movedPiece][to_sq(move)];
         // Countermoves based pruning
-        if (   lmrDepth < 5
-            && history < -4076 * (depth - 1))
+        if (   lmrDepth < shallowPruningDepthB
+            && history < shallowPruningD * (depth - 1))
           continue;
 
-        history += 2 * (*pos->mainHistory)[stm()][to_sq(move)];
+        history += shallowPruningGain * (*pos->mainHistory)[stm()][to_sq(move)];
 
         // Futility pruning: parent node
-        if (   lmrDepth < 14
+        if (   lmrDepth < shallowPruningDepthC
             && !inCheck
-            && ss->staticEval + 108 + 151 * lmrDepth + history / 61 <= alpha)
+            && ss->staticEval + shallowPruningE + shallowPruningF * lmrDepth + history / shallowPruningG <= alpha)
           continue;
 
         // Prune moves with negative SEE at low depths and below a decreasing
         // threshold at higher depths.
-        if (!see_test(pos, move, -27 * lmrDepth * lmrDepth - 16 * lmrDepth))
+        if (!see_test(pos, move, shallowPruningH * lmrDepth * lmrDepth + shallowPruningI * lmrDepth))
           continue;
       }
     }
@@ -1096,16 +1205,16 @@ moves_loop: // When in check search starts from here
     // result is lower than ttValue minus a margin, then we extend the ttMove.
     if (ss->ply < pos->rootDepth * 2)
     {
-    if (    depth >= 5 + 2 * (PvNode && tte_is_pv(tte))
+    if (    depth >= singularExtDepthA + singularExtDepthB * (PvNode && tte_is_pv(ttd))
         &&  move == ttMove
         && !rootNode
         && !excludedMove // No recursive singular search
      /* &&  ttValue != VALUE_NONE implicit in the next condition */
         &&  abs(ttValue) < VALUE_KNOWN_WIN
-        && (tte_bound(tte) & BOUND_LOWER)
-        &&  tte_depth(tte) >= depth - 2)
+        && (tte_bound(ttd) & BOUND_LOWER)
+        &&  tte_depth(ttd) >= depth - singularExtDepthC)
     {
-      Value singularBeta = ttValue - (3 + (ss->ttPv && !PvNode)) * depth;
+      Value singularBeta = ttValue - (singularBetaA + (ss->ttPv && !PvNode)) * depth;
       Depth singularDepth = (depth - 1) / 2;
       ss->excludedMove = move;
       Move cm = ss->countermove;
@@ -1117,8 +1226,8 @@ moves_loop: // When in check search starts from here
         extension = 1;
         singularQuietLMR = !ttCapture;
         if (  !PvNode
-            && value < singularBeta - 23
-            && ss->doubleExtensions <= 9)
+            && value < singularBeta - singularExtentionA
+            && ss->doubleExtensions <= singularExtentionB)
           extension = 2;
       }
 
@@ -1156,14 +1265,14 @@ moves_loop: // When in check search starts from here
 
     }
     else if (  givesCheck
-            && depth > 10
-            && abs(ss->staticEval) > 81)
+            && depth > singularExtDepthD
+            && abs(ss->staticEval) > singularExtentionC)
       extension = 1;
     // Quiet ttMove extensions (~0 Elo)
     else if (  PvNode
             && move == ttMove
             && move == ss->killers[0]
-            && (*cmh)[movedPiece][to_sq(move)] >= 4632)
+            && (*cmh)[movedPiece][to_sq(move)] >= singularExtentionD)
       extension = 1;
     }
 
@@ -1172,7 +1281,7 @@ moves_loop: // When in check search starts from here
     ss->doubleExtensions = (ss-1)->doubleExtensions + (extension == 2);
 
     // Speculative prefetch as early as possible
-    prefetch(tt_first_entry(key_after(pos, move)));
+    prefetch(tt_first_entry(&e->tt, key_after(pos, move)));
 
     // Update the current move (this must be done after singular extension
     // search)
@@ -1189,46 +1298,46 @@ moves_loop: // When in check search starts from here
     // child has been searched. In general we would like to reduce them, but
     // there are many cases where we extend a child if it has good chances
     // to be "interesting".
-    if (    depth >= 1
+    if (    depth >= lmrDepthThreshold
         &&  moveCount > 1 + (PvNode && ss->ply <= 1)
         && (   !captureOrPromotion
             || !ss->ttPv
             || (cutNode && (ss-1)->moveCount) > 1))
     {
-      Depth r = reduction(improving, depth, moveCount, delta, pos->rootDelta);
+      Depth r = reduction(pos, improving, depth, moveCount, delta);
 
       // Decrease reduction if position is or has been on the PV and the node
       // is not likely to fail low
       if (ss->ttPv && !likelyFailLow)
-        r -= 2;
+        r -= lmrDecTTPv;
 
       // Decrease reduction if opponent's move count is high
-      if ((ss-1)->moveCount > 8)
-        r -= 2;
+      if ((ss-1)->moveCount > lmrMoveCountThreshold)
+        r -= lmrDecMoveCount;
 
       // Decrease reduction if ttMove has been singularly extended
       if (singularQuietLMR)
-        r -= 0;
+        r -= lmrDecSingular;
 
       if (cutNode)
-        r += 2;
+        r += lmrIncCutNode;
 
       if (ttCapture)
-        r++;
+        r += lmrIncTTCapture;
       
       if (PvNode)
-        r -= 2 + 10 / (4 + depth);
+        r -= lmrPvNodeA + lmrPvNodeB / (lmrPvNodeC + depth);
       
-      if ((ss+1)->cutoffCnt > 3)
-        r += 2;
+      if ((ss+1)->cutoffCnt > lmrCutoffCntThresh)
+        r += lmrIncCutoffCnt;
       
       ss->statScore =    (*cmh )[movedPiece][to_sq(move)]
                        + (*fmh )[movedPiece][to_sq(move)]
                        + (*fmh2)[movedPiece][to_sq(move)]
-                       + 3 * (*pos->mainHistory)[!stm()][from_to(move)]
-                       - 4850;
+                       + lmrStatGain * (*pos->mainHistory)[!stm()][from_to(move)]
+                       - lmrStatDelta;
 
-      r -= ss->statScore / (12855 + 3631 * (depth > 8 && depth < 18));
+      r -= ss->statScore / (lmrRDecA + lmrRDecB * (depth > lmrRDecDepthA && depth < lmrRDecDepthB));
       Depth d = clamp(newDepth - r, 1, newDepth + 1);
 
       value = -search_NonPV(pos, ss+1, -(alpha+1), d, 1);
@@ -1238,7 +1347,7 @@ moves_loop: // When in check search starts from here
       {
           // Adjust full depth search based on LMR results - if result
           // was good enough search deeper, if it was bad enough search shallower
-          const bool doDeeperSearch = value > (alpha + 60 + 11 * (newDepth - d));
+          const bool doDeeperSearch = value > (alpha + lmrDeepSearchA + lmrDeepSearchB * (newDepth - d));
           const bool doShallowerSearch = value < bestValue + newDepth;
 
           newDepth += doDeeperSearch - doShallowerSearch;
@@ -1282,7 +1391,7 @@ moves_loop: // When in check search starts from here
     // Finished searching the move. If a stop occurred, the return value of
     // the search cannot be trusted, and we return immediately without
     // updating best move, PV and TT.
-    if (load_rlx(Threads.stop))
+    if (load_rlx(e->threads.stop))
       return 0;
 
     if (rootNode) {
@@ -1361,7 +1470,7 @@ moves_loop: // When in check search starts from here
   // been completed. But in this case bestValue is valid because we have
   // fully searched our subtree, and we can anyhow save the result in TT.
   /*
-  if (Threads.stop)
+  if (e->threads.stop)
     return VALUE_DRAW;
   */
 
@@ -1375,7 +1484,7 @@ moves_loop: // When in check search starts from here
   else if (bestMove) {
     // Quiet best move: update move sorting heuristics
     if (!is_capture(pos, bestMove)) {
-      int bonus =  bestValue > beta + 126
+      int bonus =  bestValue > beta + mateBetaDelta
                  ? stat_bonus(depth + 1)
                  : stat_bonus(depth);
       update_quiet_stats(pos, ss, bestMove, bonus);
@@ -1398,14 +1507,14 @@ moves_loop: // When in check search starts from here
       update_cm_stats(ss-1, piece_on(prevSq), prevSq, -stat_bonus(depth + 1));
   }
   // Bonus for prior countermove that caused the fail low
-  else if (   (depth >= 5 || PvNode)
+  else if (   (depth >= mateDepthThreshold || PvNode)
            && !captured_piece())
   {
     //Assign extra bonus if current node is PvNode or cutNode
     //or fail low was really bad
     bool extraBonus =    PvNode
                       || cutNode
-                      || bestValue < alpha - 69 * depth;
+                      || bestValue < alpha - mateExtraBonus * depth;
     update_cm_stats(ss-1, piece_on(prevSq), prevSq, stat_bonus(depth) * (1 + extraBonus));
   }
 
@@ -1419,7 +1528,7 @@ moves_loop: // When in check search starts from here
     ss->ttPv = ss->ttPv || ((ss-1)->ttPv && depth > 3);
 
   if (!excludedMove && !(rootNode && pos->pvIdx))
-    tte_save(tte, posKey, value_to_tt(bestValue, ss->ply), ss->ttPv,
+    tte_save(&e->tt, tte, posKey, value_to_tt(bestValue, ss->ply), ss->ttPv,
         bestValue >= beta ? BOUND_LOWER :
         PvNode && bestMove ? BOUND_EXACT : BOUND_UPPER,
         depth, bestMove, ss->staticEval);
@@ -1449,6 +1558,7 @@ static NOINLINE Value search_NonPV(Position *pos, Stack *ss, Value alpha,
 INLINE Value qsearch_node(Position *pos, Stack *ss, Value alpha, Value beta,
     Depth depth, const int NT, const bool InCheck)
 {
+  Engine *e = pos->engine;
   const bool PvNode = NT == PV;
 
   assert(InCheck == (bool)checkers());
@@ -1457,7 +1567,7 @@ INLINE Value qsearch_node(Position *pos, Stack *ss, Value alpha, Value beta,
   assert(depth <= 0);
 
   Move pv[MAX_PLY+1];
-  TTEntry *tte;
+  TTEntry *tte, *ttd, ttData;
   Key posKey;
   Move ttMove, move, bestMove;
   Value bestValue, value, ttValue, futilityValue, futilityBase;
@@ -1487,18 +1597,31 @@ INLINE Value qsearch_node(Position *pos, Stack *ss, Value alpha, Value beta,
 
   // Transposition table lookup
   posKey = key();
-  tte = tt_probe(posKey, &ss->ttHit);
-  ttValue = ss->ttHit ? value_from_tt(tte_value(tte), ss->ply, rule50_count()) : VALUE_NONE;
-  ttMove = ss->ttHit ? tte_move(tte) : 0;
-  pvHit = ss->ttHit && tte_is_pv(tte);
+  tte = tt_probe(&e->tt, posKey, &ss->ttHit, &ttData);
+  ttd = tt_data(tte, &ttData);
+  pos->ttProbes++;
+  pos->ttHits += ss->ttHit;
+  ttValue = ss->ttHit ? value_from_tt(tte_value(ttd), ss->ply, rule50_count()) : VALUE_NONE;
+  ttMove = ss->ttHit ? tte_move(ttd) : 0;
+  pvHit = ss->ttHit && tte_is_pv(ttd);
+#ifdef TT_STATS
+  tt_stats_probe(&pos->ttStats, &e->tt, ttd, ss->ttHit);
+  if (ttMove && !is_pseudo_legal(pos, ttMove))
+    pos->ttStats.falseHits++;
+#endif
 
   if (  !PvNode
       && ss->ttHit
-      && tte_depth(tte) >= ttDepth
+      && tte_depth(ttd) >= ttDepth
       && ttValue != VALUE_NONE // Only in case of TT access race
-      && (ttValue >= beta ? (tte_bound(tte) &  BOUND_LOWER)
-                          : (tte_bound(tte) &  BOUND_UPPER)))
+      && (ttValue >= beta ? (tte_bound(ttd) &  BOUND_LOWER)
+                          : (tte_bound(ttd) &  BOUND_UPPER)))
+  {
+#ifdef TT_STATS
+    pos->ttStats.cutoffs++;
+#endif
     return ttValue;
+  }
 
   // Evaluate the position statically
   if (InCheck) {
@@ -1507,12 +1630,12 @@ INLINE Value qsearch_node(Position *pos, Stack *ss, Value alpha, Value beta,
   } else {
     if (ss->ttHit) {
       // Never assume anything about values stored in TT
-      if ((ss->staticEval = bestValue = tte_eval(tte)) == VALUE_NONE)
+      if ((ss->staticEval = bestValue = tte_eval(ttd)) == VALUE_NONE)
          ss->staticEval = bestValue = evaluate(pos);
 
       // Can ttValue be used as a better position evaluation?
       if (    ttValue != VALUE_NONE
-          && (tte_bound(tte) & (ttValue > bestValue ? BOUND_LOWER : BOUND_UPPER)))
+          && (tte_bound(ttd) & (ttValue > bestValue ? BOUND_LOWER : BOUND_UPPER)))
         bestValue = ttValue;
     } else
       ss->staticEval = bestValue =
@@ -1522,7 +1645,7 @@ INLINE Value qsearch_node(Position *pos, Stack *ss, Value alpha, Value beta,
     // Stand pat. Return immediately if static value is at least beta
     if (bestValue >= beta) {
       if (!ss->ttHit)
-        tte_save(tte, posKey, value_to_tt(bestValue, ss->ply), false,
+        tte_save(&e->tt, tte, posKey, value_to_tt(bestValue, ss->ply), false,
             BOUND_LOWER, DEPTH_NONE, 0, ss->staticEval);
 
       return bestValue;
@@ -1531,7 +1654,7 @@ INLINE Value qsearch_node(Position *pos, Stack *ss, Value alpha, Value beta,
     if (PvNode && bestValue > alpha)
       alpha = bestValue;
 
-    futilityBase = bestValue + 155;
+    futilityBase = bestValue + futilityBaseDelta;
   }
 
   ss->history = &(*pos->counterMoveHistory)[0][0];
@@ -1548,9 +1671,7 @@ INLINE Value qsearch_node(Position *pos, Stack *ss, Value alpha, Value beta,
   // Loop through the moves until no moves remain or a beta cutoff occurs
   while ((move = next_move(pos, 0))) {
     assert(move_is_ok(move));
-
-    if (!is_legal(pos, move))
-      continue;
+    assert(is_legal(pos, move));
 
     givesCheck = gives_check(pos, ss, move);
     captureOrPromotion = is_capture(pos, move);
@@ -1585,7 +1706,7 @@ INLINE Value qsearch_node(Position *pos, Stack *ss, Value alpha, Value beta,
       continue;
 
     // Speculative prefetch as early as possible
-    prefetch(tt_first_entry(key_after(pos, move)));
+    prefetch(tt_first_entry(&e->tt, key_after(pos, move)));
 
     ss->currentMove = move;
     bool captureOrPromotion = is_capture(pos, move);
@@ -1641,7 +1762,7 @@ INLINE Value qsearch_node(Position *pos, Stack *ss, Value alpha, Value beta,
   if (InCheck && bestValue == -VALUE_INFINITE)
     return mated_in(ss->ply); // Plies to mate from the root
 
-  tte_save(tte, posKey, value_to_tt(bestValue, ss->ply), pvHit,
+  tte_save(&e->tt, tte, posKey, value_to_tt(bestValue, ss->ply), pvHit,
       bestValue >= beta ? BOUND_LOWER : BOUND_UPPER,
       ttDepth, bestMove, ss->staticEval);
 
@@ -1807,7 +1928,7 @@ static void update_quiet_stats(const Position *pos, Stack *ss, Move move,
 
   Move Skill::pick_best(size_t multiPV) {
 
-    const RootMoves& rm = Threads.main()->rootMoves;
+    const RootMoves& rm = e->threads.main()->rootMoves;
     static PRNG rng(now()); // PRNG sequence should be non-deterministic
 
     // RootMoves are already sorted by score in descending order
@@ -1840,18 +1961,18 @@ static void update_quiet_stats(const Position *pos, Stack *ss, Move move,
 // check_time() is used to print debug info and, more importantly, to detect
 // when we are out of available time and thus stop the search.
 
-static void check_time(void)
+static void check_time(Engine *e)
 {
-  TimePoint elapsed = time_elapsed();
+  TimePoint elapsed = time_elapsed(e);
 
   // An engine may not stop pondering until told so by the GUI
-  if (Threads.ponder)
+  if (e->threads.ponder)
     return;
 
-  if (   (use_time_management() && elapsed > time_maximum() - 10)
-      || (Limits.movetime && elapsed >= Limits.movetime)
-      || (Limits.nodes && threads_nodes_searched() >= Limits.nodes))
-        Threads.stop = 1;
+  if (   (use_time_management(e) && elapsed > time_maximum(e) - 10)
+      || (e->limits.movetime && elapsed >= e->limits.movetime)
+      || (e->limits.nodes && threads_nodes_searched(e) >= e->limits.nodes))
+        e->threads.stop = 1;
 }
 
 // uci_print_pv() prints PV information according to the UCI protocol.
@@ -1860,13 +1981,14 @@ static void check_time(void)
 
 static void uci_print_pv(Position *pos, Depth depth, Value alpha, Value beta)
 {
-  TimePoint elapsed = time_elapsed() + 1;
+  Engine *e = pos->engine;
+  TimePoint elapsed = time_elapsed(e) + 1;
   RootMoves *rm = pos->rootMoves;
   int pvIdx = pos->pvIdx;
   // int multiPV = min(option_value(OPT_MULTI_PV), rm->size);
   int multiPV = min(1, rm->size);
-  uint64_t nodes_searched = threads_nodes_searched();
-  uint64_t tbhits = threads_tb_hits();
+  uint64_t nodes_searched = threads_nodes_searched(e);
+  uint64_t tbhits = threads_tb_hits(e);
   char buf[16];
 
   flockfile(stdout);
@@ -1895,7 +2017,7 @@ static void uci_print_pv(Position *pos, Depth depth, Value alpha, Value beta)
                               nodes_searched * 1000 / elapsed);
 
     if (elapsed > 1000)
-      printf(" hashfull %d", tt_hashfull());
+      printf(" hashfull %d", tt_hashfull(&e->tt));
 
     printf(" tbhits %"PRIu64" time %"PRIi64" pv", tbhits, elapsed);
 
@@ -1924,10 +2046,11 @@ static int extract_ponder_from_tt(RootMove *rm, Position *pos)
     return 0;
 
   do_move(pos, rm->pv[0], gives_check(pos, pos->st, rm->pv[0]));
-  TTEntry *tte = tt_probe(key(), &ttHit);
+  TTEntry ttData;
+  TTEntry *tte = tt_probe(&pos->engine->tt, key(), &ttHit, &ttData);
 
   if (ttHit) {
-    Move m = tte_move(tte); // Local copy to be SMP safe
+    Move m = tte_move(tt_data(tte, &ttData)); // Local copy to be SMP safe
     ExtMove list[MAX_MOVES];
     ExtMove *last = generate_legal(pos, list);
     for (ExtMove *p = list; p < last; p++)
@@ -1947,41 +2070,50 @@ static int extract_ponder_from_tt(RootMove *rm, Position *pos)
 
 void start_thinking(Position *root, bool ponderMode)
 {
-  if (Threads.searching)
-    thread_wait_until_sleeping(threads_main());
+  Engine *e = root->engine;
 
-  Threads.stopOnPonderhit = false;
-  Threads.stop = false;
-  Threads.increaseDepth = true;
-  Threads.ponder = ponderMode;
+  if (e->threads.searching)
+    thread_wait_until_sleeping(threads_main(e));
+
+  e->threads.stopOnPonderhit = false;
+  e->threads.stop = false;
+  e->threads.increaseDepth = true;
+  e->threads.ponder = ponderMode;
 
   // Generate all legal moves.
   ExtMove list[MAX_MOVES];
   ExtMove *end = generate_legal(root, list);
 
   // Implement searchmoves option.
-  if (Limits.numSearchmoves) {
+  if (e->limits.numSearchmoves) {
     ExtMove *p = list;
     for (ExtMove *m = p; m < end; m++)
-      for (int i = 0; i < Limits.numSearchmoves; i++)
-        if (m->move == Limits.searchmoves[i]) {
+      for (int i = 0; i < e->limits.numSearchmoves; i++)
+        if (m->move == e->limits.searchmoves[i]) {
           (p++)->move = m->move;
           break;
         }
     end = p;
   }
 
-  RootMoves *moves = Threads.pos[0]->rootMoves;
+  RootMoves *moves = e->threads.pos[0]->rootMoves;
   moves->size = end - list;
   for (int i = 0; i < moves->size; i++)
     moves->move[i].pv[0] = list[i].move;
 
-  for (int idx = 0; idx < Threads.numThreads; idx++) {
-    Position *pos = Threads.pos[idx];
+  for (int idx = 0; idx < e->threads.numThreads; idx++) {
+    Position *pos = e->threads.pos[idx];
     pos->selDepth = 0;
     pos->nmpMinPly = 0;
     pos->rootDepth = 0;
-    pos->nodes = pos->tbHits = 0;
+    pos->nodes = pos->tbHits = pos->ttProbes = pos->ttHits = 0;
+#ifndef NNUE_PURE
+    if (pos->evalCache)
+      pos->evalCache->probes = pos->evalCache->hits = 0;
+#endif
+#ifdef TT_STATS
+    memset(&pos->ttStats, 0, sizeof(pos->ttStats));
+#endif
     RootMoves *rm = pos->rootMoves;
     rm->size = end - list;
     for (int i = 0; i < rm->size; i++) {
@@ -1993,16 +2125,9 @@ void start_thinking(Position *root, bool ponderMode)
       rm->move[i].tbRank = moves->move[i].tbRank;
       rm->move[i].tbScore = moves->move[i].tbScore;
     }
-    memcpy(pos, root, offsetof(Position, moveList));
-    // Copy enough of the root State buffer.
-    int n = max(7, root->st->pliesFromNull);
-    for (int i = 0; i <= n; i++)
-      memcpy(&pos->stack[i], &root->st[i - n], StateSize);
-    pos->st = pos->stack + n;
-    (pos->st-1)->endMoves = pos->moveList;
-    pos_set_check_info(pos);
+    copy_root(pos, root);
   }
 
-  Threads.searching = true;
-  thread_wake_up(threads_main(), THREAD_SEARCH);
+  e->threads.searching = true;
+  thread_wake_up(threads_main(e), THREAD_SEARCH);
 }
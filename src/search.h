@@ -72,16 +72,34 @@ struct LimitsType {
 
 typedef struct LimitsType LimitsType;
 
-extern LimitsType Limits;
+#define use_time_management(e) \
+  ((e)->limits.time[WHITE] || (e)->limits.time[BLACK])
 
-INLINE int use_time_management(void)
-{
-  return Limits.time[WHITE] || Limits.time[BLACK];
-}
+// PerftState holds the root moves of a perft() run, which the search
+// threads of the engine share out, and the optional table of subtree
+// counts.
 
-void search_init(void);
-void search_clear(void);
-uint64_t perft(Position *pos, Depth depth);
+typedef struct {
+  Key key; // Position key xor node count, so torn writes fail validation
+  uint64_t nodes;
+} PerftEntry;
+
+struct PerftState {
+  ExtMove moves[MAX_MOVES];
+  uint64_t nodes[MAX_MOVES];
+  int numMoves;
+  atomic_int next;
+  Depth depth;
+  PerftEntry *table;
+  size_t mask;
+};
+
+typedef struct PerftState PerftState;
+
+void search_init(Engine *e);
+void search_clear(Engine *e);
+uint64_t perft(Position *pos, Depth depth, bool divide);
+void perft_worker(Position *pos);
 void start_thinking(Position *pos, bool ponderMode);
 
 #endif
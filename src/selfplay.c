@@ -0,0 +1,442 @@
+/*
+  Stockfish, a UCI chess playing engine derived from Glaurung 2.1
+  Copyright (C) 2004-2008 Tord Romstad (Glaurung author)
+  Copyright (C) 2008-2015 Marco Costalba, Joona Kiiski, Tord Romstad
+  Copyright (C) 2015-2016 Marco Costalba, Joona Kiiski, Gary Linscott, Tord Romstad
+
+  Stockfish is free software: you can redistribute it and/or modify
+  it under the terms of the GNU General Public License as published by
+  the Free Software Foundation, either version 3 of the License, or
+  (at your option) any later version.
+
+  Stockfish is distributed in the hope that it will be useful,
+  but WITHOUT ANY WARRANTY; without even the implied warranty of
+  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+  GNU General Public License for more details.
+
+  You should have received a copy of the GNU General Public License
+  along with this program.  If not, see <http://www.gnu.org/licenses/>.
+*/
+
+#include <inttypes.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <strings.h>
+
+#include "engine.h"
+#include "misc.h"
+#include "movegen.h"
+#include "params.h"
+#include "position.h"
+#include "search.h"
+#include "settings.h"
+#include "thread.h"
+#include "tt.h"
+#include "uci.h"
+
+#ifndef _WIN32
+#define THREAD_FUNC void *
+#else
+#define THREAD_FUNC DWORD WINAPI
+#endif
+
+// Adjudication rules, the same as the cutechess-cli settings used by the
+// tuning scripts: "-resign movecount=8 score=600" and
+// "-draw movenumber=40 movecount=8 score=20".
+enum {
+  ResignMoveCount = 8, ResignScore = 600,
+  DrawMoveNumber = 40, DrawMoveCount = 8, DrawScore = 20,
+  MaxGamePlies = 1000
+};
+
+enum { RESULT_LOSS, RESULT_DRAW, RESULT_WIN };
+
+// Match holds the settings of a match and the results so far, which the
+// worker threads update under the lock.
+
+typedef struct {
+  int games, concurrency;
+  int64_t time, inc, nodes;
+  int depth;
+  int hashMB;
+  uint64_t seed;
+  char **openings;
+  int numOpenings;
+#ifdef TUNE
+  Params params[2];
+#endif
+  int *pairOpening; // Index of the opening of each game pair
+  LOCK_T lock;
+  int nextPair;
+  int wins, losses, draws, penta[5];
+} Match;
+
+#ifdef TUNE
+// parse_side_params() reads a list "name=value,name=value" of tunable
+// parameters for one engine. It returns false on an unknown parameter.
+
+static bool parse_side_params(Params *p, char *str)
+{
+  while (*str) {
+    size_t len = strcspn(str, ",");
+    char *next = str[len] ? str + len + 1 : str + len;
+    str[len] = 0;
+    char *eq = strchr(str, '=');
+    if (eq)
+      *eq = 0;
+    if (!eq || !params_set(p, str, atoi(eq + 1))) {
+      fprintf(stderr, "No such parameter: %s\n", str);
+      return false;
+    }
+    str = next;
+  }
+
+  return true;
+}
+#endif
+
+// read_openings() reads an EPD file. Only the first four fields are used,
+// so that the lines can be given to position() as FENs.
+
+static char **read_openings(const char *file, int *num)
+{
+  FILE *F = fopen(file, "r");
+  if (!F) {
+    fprintf(stderr, "Unable to open file %s\n", file);
+    return NULL;
+  }
+
+  int max = 100;
+  char **list = malloc(max * sizeof(*list));
+  char *line = NULL;
+  size_t length = 0;
+  *num = 0;
+  while (getline(&line, &length, F) > 0) {
+    char fen[128], *p = line;
+    int fields = 0;
+    while (*p && *p != '\n' && *p != '\r' && *p != ';') {
+      if (*p == ' ' && ++fields == 4)
+        break;
+      p++;
+    }
+    if (p == line || p - line > 100)
+      continue;
+    sprintf(fen, "fen %.*s", (int)(p - line), line);
+    if (*num == max) {
+      max += 100;
+      list = realloc(list, max * sizeof(*list));
+    }
+    list[(*num)++] = strdup(fen);
+  }
+  free(line);
+  fclose(F);
+
+  return list;
+}
+
+static bool insufficient_material(const Position *pos)
+{
+  return   !pieces_p(PAWN) && !pieces_pp(ROOK, QUEEN)
+        && popcount(pieces()) <= 3;
+}
+
+// play_game() plays one game between the two engines from the given
+// opening and returns the result for the first engine, which plays the
+// side to move in the opening position if first is true.
+
+static int play_game(Match *m, Position *pos, const char *opening,
+    bool first, Engine engines[2])
+{
+  size_t size = strlen(opening) + 8 * MaxGamePlies + 16;
+  char *game = malloc(size), *buf = malloc(size);
+  Key keys[MaxGamePlies + 1];
+  int64_t clock[2] = { m->time, m->time };
+  int resignCnt[2] = { 0 }, drawCnt = 0;
+  int result = RESULT_DRAW;
+
+  sprintf(game, "%s moves", opening);
+
+  for (int i = 0; i < 2; i++)
+    search_clear(&engines[i]);
+
+  for (int ply = 0; ply < MaxGamePlies; ply++) {
+    // The engine to move: 0 is the first engine, 1 the second.
+    int e = (ply & 1) ^ !first;
+
+    pos->engine = &engines[e];
+    strcpy(buf, game);
+    position(pos, buf);
+    keys[ply] = pos->st->key;
+
+    ExtMove list[MAX_MOVES];
+    if (generate_legal(pos, list) == list) {
+      if (checkers())
+        result = e == 0 ? RESULT_LOSS : RESULT_WIN;
+      break;
+    }
+
+    int reps = 0;
+    for (int i = ply - 4; i >= 0 && i >= ply - rule50_count(); i -= 2)
+      reps += keys[i] == keys[ply];
+    if (rule50_count() >= 100 || reps >= 2 || insufficient_material(pos))
+      break;
+
+    LimitsType *limits = &engines[e].limits;
+    *limits = (struct LimitsType){ 0 };
+    limits->startTime = now();
+    if (m->time) {
+      limits->time[stm()] = clock[e];
+      limits->inc[stm()] = m->inc;
+    }
+    limits->nodes = m->nodes;
+    limits->depth = m->depth;
+
+    start_thinking(pos, false);
+    thread_wait_until_sleeping(threads_main(&engines[e]));
+
+    if (m->time) {
+      clock[e] -= now() - limits->startTime;
+      if (clock[e] < 0) {
+        result = e == 0 ? RESULT_LOSS : RESULT_WIN;
+        break;
+      }
+      clock[e] += m->inc;
+    }
+
+    RootMove *rm = &threads_main(&engines[e])->rootMoves->move[0];
+    Value score = rm->score;
+
+    resignCnt[e] = score <= -ResignScore ? resignCnt[e] + 1 : 0;
+    if (resignCnt[e] >= ResignMoveCount) {
+      result = e == 0 ? RESULT_LOSS : RESULT_WIN;
+      break;
+    }
+
+    drawCnt = abs(score) <= DrawScore ? drawCnt + 1 : 0;
+    if (   game_ply() / 2 + 1 >= DrawMoveNumber
+        && drawCnt >= 2 * DrawMoveCount)
+      break;
+
+    strcat(game, " ");
+    uci_move(game + strlen(game), rm->pv[0], false);
+  }
+
+  free(game);
+  free(buf);
+
+  return result;
+}
+
+// record_pair() adds the results of a game pair to the match and prints
+// the score so far. result[1] is negative if the second game was not played.
+
+static void record_pair(Match *m, int result[2])
+{
+  LOCK(m->lock);
+
+  for (int i = 0; i < 2; i++) {
+    if (result[i] < 0)
+      continue;
+    m->wins   += result[i] == RESULT_WIN;
+    m->losses += result[i] == RESULT_LOSS;
+    m->draws  += result[i] == RESULT_DRAW;
+  }
+  if (result[1] >= 0)
+    m->penta[result[0] + result[1]]++;
+
+  int n = m->wins + m->losses + m->draws;
+  printf("Score of first vs second: %d - %d - %d  [%.3f] %d\n",
+         m->wins, m->losses, m->draws, (m->wins + 0.5 * m->draws) / n, n);
+  printf("Pentanomial: [%d, %d, %d, %d, %d]\n",
+         m->penta[0], m->penta[1], m->penta[2], m->penta[3], m->penta[4]);
+  fflush(stdout);
+
+  UNLOCK(m->lock);
+}
+
+// selfplay_worker() is run by each worker thread. It takes game pairs from
+// the match until none are left. Each side has an engine of its own with a
+// single search thread, its own hash table and its own parameters.
+
+static THREAD_FUNC selfplay_worker(void *arg)
+{
+  Match *m = arg;
+
+  Engine *engines = calloc(2, sizeof(Engine));
+  for (int i = 0; i < 2; i++) {
+    threads_init(&engines[i]);
+    engines[i].silent = true;
+#ifdef TUNE
+    engines[i].params = m->params[i];
+    search_init(&engines[i]);
+#endif
+    tt_allocate(&engines[i], (size_t)m->hashMB * 1024);
+  }
+
+  Position pos;
+  memset(&pos, 0, sizeof(pos));
+  pos.stackAllocation = malloc(63 + 215 * sizeof(Stack));
+  pos.stack = (Stack *)(((uintptr_t)pos.stackAllocation + 0x3f) & ~0x3f);
+  pos.moveList = malloc(1000 * sizeof(ExtMove));
+  pos.st = pos.stack + 100;
+  pos.st[-1].endMoves = pos.moveList;
+
+  int numPairs = (m->games + 1) / 2;
+  while (true) {
+    LOCK(m->lock);
+    int pair = m->nextPair++;
+    UNLOCK(m->lock);
+    if (pair >= numPairs)
+      break;
+
+    const char *opening = m->openings[m->pairOpening[pair]];
+    int result[2];
+    result[0] = play_game(m, &pos, opening, true, engines);
+    result[1] =  2 * pair + 1 < m->games
+               ? play_game(m, &pos, opening, false, engines) : -1;
+    record_pair(m, result);
+  }
+
+  for (int i = 0; i < 2; i++) {
+    threads_exit(&engines[i]);
+    tt_free(&engines[i].tt);
+  }
+  free(engines);
+  game_free(&pos);
+  free(pos.stackAllocation);
+  free(pos.moveList);
+
+  return 0;
+}
+
+// selfplay() plays a match between two sets of parameters in this process,
+// replacing a cutechess-cli run for tuning. The arguments are keyword
+// value pairs:
+// - games <n>: number of games, played in pairs with colors reversed
+//   from the same opening. Default is 2.
+// - concurrency <n>: number of games played in parallel, each on a worker
+//   thread of its own. Default is 1.
+// - openings <file>: EPD file with the opening positions. Default is the
+//   start position.
+// - tc <seconds>[+<increment>]: time control for the whole game. Default
+//   is 10.
+// - nodes <n>, depth <n>: fixed limit per move instead of a time control.
+// - hash <MB>: hash size for each engine. Default is 16.
+// - seed <n>: seed for the random order of the openings.
+// - first <params>, second <params>: comma separated name=value tunable
+//   parameters of each engine in a tune=yes build, e.g.
+//   "first reductionA=1700,statBonusB=290". Each engine searches with one
+//   thread and its own hash table, so Threads and Hash have no effect here.
+// After each game pair the score of the first engine is printed in the
+// format of cutechess-cli, followed by the pentanomial counts of the
+// game pairs (LL, LD, LW+DD, DW, WW).
+
+void selfplay(Position *current, char *str)
+{
+  (void)current;
+
+  Match m = { .games = 2, .concurrency = 1, .time = 10000, .hashMB = 16 };
+  char *openingFile = NULL, *token;
+
+  m.seed = now();
+#ifdef TUNE
+  m.params[0] = m.params[1] = DefaultEngine.params;
+#endif
+
+  for (token = strtok(str, " \t"); token; token = strtok(NULL, " \t")) {
+    char *arg = strtok(NULL, " \t");
+    if (!arg)
+      break;
+    if (strcmp(token, "games") == 0)
+      m.games = atoi(arg);
+    else if (strcmp(token, "concurrency") == 0)
+      m.concurrency = atoi(arg);
+    else if (strcmp(token, "openings") == 0)
+      openingFile = arg;
+    else if (strcmp(token, "tc") == 0) {
+      char *inc = strchr(arg, '+');
+      m.time = 1000 * atof(arg);
+      m.inc = inc ? 1000 * atof(inc + 1) : 0;
+    }
+    else if (strcmp(token, "nodes") == 0)
+      m.nodes = atoll(arg), m.time = 0;
+    else if (strcmp(token, "depth") == 0)
+      m.depth = atoi(arg), m.time = 0;
+    else if (strcmp(token, "hash") == 0)
+      m.hashMB = atoi(arg);
+    else if (strcmp(token, "seed") == 0)
+      m.seed = strtoull(arg, NULL, 10);
+    else if (strcmp(token, "first") == 0 || strcmp(token, "second") == 0) {
+#ifdef TUNE
+      if (!parse_side_params(&m.params[token[0] == 's'], arg))
+        return;
+#else
+      fprintf(stderr, "Parameters can only be set in a tune=yes build\n");
+      return;
+#endif
+    }
+  }
+
+  if (m.games < 1 || m.concurrency < 1 || m.hashMB < 1)
+    return;
+
+  if (openingFile) {
+    if (!(m.openings = read_openings(openingFile, &m.numOpenings)))
+      return;
+    if (!m.numOpenings) {
+      fprintf(stderr, "No openings in %s\n", openingFile);
+      free(m.openings);
+      return;
+    }
+  } else {
+    m.openings = malloc(sizeof(*m.openings));
+    m.openings[0] = strdup("startpos");
+    m.numOpenings = 1;
+  }
+
+  if (DefaultEngine.threads.searching)
+    thread_wait_until_sleeping(threads_main(&DefaultEngine));
+  process_delayed_settings();
+
+  // The openings are drawn up front, so that the seed alone decides which
+  // pair plays which opening.
+  int numPairs = (m.games + 1) / 2;
+  m.concurrency = min(m.concurrency, numPairs);
+  m.pairOpening = malloc(numPairs * sizeof(int));
+  PRNG rng;
+  prng_init(&rng, m.seed);
+  for (int i = 0; i < numPairs; i++)
+    m.pairOpening[i] = prng_rand(&rng) % m.numOpenings;
+
+  LOCK_INIT(m.lock);
+#ifndef _WIN32
+  pthread_t *threads = malloc(m.concurrency * sizeof(pthread_t));
+#else
+  HANDLE *threads = malloc(m.concurrency * sizeof(HANDLE));
+#endif
+
+  fflush(stdout);
+  for (int i = 0; i < m.concurrency; i++) {
+#ifndef _WIN32
+    pthread_create(&threads[i], NULL, selfplay_worker, &m);
+#else
+    threads[i] = CreateThread(NULL, 0, selfplay_worker, &m, 0, NULL);
+#endif
+  }
+  for (int i = 0; i < m.concurrency; i++) {
+#ifndef _WIN32
+    pthread_join(threads[i], NULL);
+#else
+    WaitForSingleObject(threads[i], INFINITE);
+    CloseHandle(threads[i]);
+#endif
+  }
+
+  LOCK_DESTROY(m.lock);
+  free(threads);
+  free(m.pairOpening);
+  for (int i = 0; i < m.numOpenings; i++)
+    free(m.openings[i]);
+  free(m.openings);
+}
@@ -1,28 +1,122 @@
 #ifdef NNUE
 #include "nnue.h"
 #endif
+#include "engine.h"
+#include "evaluate.h"
+#include "material.h"
 #include "numa.h"
+#include "pawns.h"
 #include "search.h"
 #include "settings.h"
 #include "thread.h"
 #include "tt.h"
 #include "types.h"
+#include "uci.h"
 
 struct settings settings, delayedSettings;
 
-// Process Hash, Threads, NUMA and LargePages settings.
+// memory_budget() sizes the transposition table, the pawn and material
+// tables and the EvalCache of each search thread so that the data structures
+// listed by memstat fit in the MemoryBudget. The static tables, the counter
+// move history tables and the fixed-size part of each thread are taken off
+// the top. The per-thread caches are halved until they use at most an eighth
+// of what is left, the EvalCache option setting being the largest eval cache
+// used. The TT gets the rest. Returns the TT size in kB, or 0 if
+// the budget cannot hold even the smallest tables.
+
+static size_t memory_budget(int *entries, int *evalEntries)
+{
+  size_t budget = delayedSettings.memoryBudget * 1024;
+  size_t threads = delayedSettings.numThreads;
+#ifdef PER_THREAD_CMH
+  size_t numCmh = threads;
+#else
+  size_t numCmh = delayedSettings.numaEnabled ? threads : 1;
+#endif
+  size_t base = thread_memory(0, 0);
+  size_t fixed =  static_tables_memory(false)
+                + numCmh * sizeof(CounterMoveHistoryStat)
+                + threads * base;
+  size_t avail = budget > fixed ? budget - fixed : 0;
+
+  // The eval cache keeps the ratio of the default sizes, 8 entries per
+  // pawn table entry, up to the size set by the EvalCache option.
+  int n = 16384, ev;
+  size_t caches;
+  while (true) {
+    ev = min(*evalEntries, 8 * n);
+    caches = threads * (thread_memory(n, n) - base);
+#ifndef NNUE_PURE
+    caches += threads * eval_cache_size(ev);
+#endif
+    if (n == 64 || caches <= avail / 8)
+      break;
+    n /= 2;
+  }
+
+  // The TT needs at least 1 kB. The warning is only given once for the
+  // same settings, as the settings are processed again on each command
+  // that needs them.
+  if (budget < fixed + caches + 1024) {
+    static size_t warnedBudget, warnedThreads;
+    if (budget != warnedBudget || threads != warnedThreads) {
+      printf("info string MemoryBudget %zu kB is below the %zu kB needed for "
+             "%zu thread(s), using Hash instead.\n",
+             budget / 1024, (fixed + caches + 2047) / 1024, threads);
+      fflush(stdout);
+      warnedBudget = budget, warnedThreads = threads;
+    }
+    return 0;
+  }
+
+  *entries = n;
+  *evalEntries = ev;
+  return (budget - fixed - caches) / 1024;
+}
+
+// Process Hash, MemoryBudget, EvalCache, Threads, NUMA and LargePages settings for the
+// UCI engine.
 
 void process_delayed_settings(void)
 {
-  bool ttChange = delayedSettings.ttSize != settings.ttSize;
+  Engine *e = &DefaultEngine;
+  size_t ttSize = delayedSettings.ttSize;
+  int cacheEntries = 0;
+#ifndef NNUE_PURE
+  int evalEntries = eval_cache_entries(delayedSettings.evalCacheSize);
+#else
+  int evalEntries = 0;
+#endif
+  size_t budgetSize;
+  if (   delayedSettings.memoryBudget
+      && (budgetSize = memory_budget(&cacheEntries, &evalEntries)))
+    ttSize = budgetSize;
+#ifndef NNUE_PURE
+  int pawnEntries = cacheEntries ? cacheEntries : PAWN_ENTRIES;
+  int materialEntries = cacheEntries ? cacheEntries : MATERIAL_ENTRIES;
+#else
+  int pawnEntries = 0, materialEntries = 0;
+#endif
+
+  bool ttChange = ttSize != settings.ttSize;
   bool lpChange = delayedSettings.largePages != settings.largePages;
   bool numaChange =   settings.numaEnabled != delayedSettings.numaEnabled
                    || (   settings.numaEnabled
                        && !masks_equal(settings.mask, delayedSettings.mask));
+  bool cacheChange =   pawnEntries != e->pawnEntries
+                    || materialEntries != e->materialEntries
+                    || evalEntries != e->evalEntries;
+  bool ttRealloc = numaChange || ttChange || lpChange;
+
+  // Entries in the old TT are normally carried over to the new one. Under a
+  // MemoryBudget the old TT is released before creating threads instead, so
+  // that the old and the new allocations are never live at the same time.
+  if (ttRealloc && delayedSettings.memoryBudget)
+    tt_free(&e->tt);
 
 #ifdef NUMA
   if (numaChange) {
-    threads_set_number(0);
+    threads_set_number(e, 0);
     settings.numThreads = 0;
 #ifndef _WIN32
     if ((settings.numaEnabled = delayedSettings.numaEnabled))
@@ -32,21 +126,30 @@ void process_delayed_settings(void)
   }
 #endif
 
+  // The pawn and material tables and the eval cache are allocated by each
+  // thread when it is created, so resizing them means recreating the threads.
+  if (cacheChange) {
+    threads_set_number(e, 0);
+    settings.numThreads = 0;
+    e->pawnEntries = pawnEntries;
+    e->materialEntries = materialEntries;
+    e->evalEntries = evalEntries;
+  }
+
   if (settings.numThreads != delayedSettings.numThreads) {
     settings.numThreads = delayedSettings.numThreads;
-    threads_set_number(settings.numThreads);
+    threads_set_number(e, settings.numThreads);
   }
 
-  if (numaChange || ttChange || lpChange) {
-    tt_free();
+  if (ttRealloc) {
     settings.largePages = delayedSettings.largePages;
-    settings.ttSize = delayedSettings.ttSize;
-    tt_allocate(settings.ttSize);
+    settings.ttSize = ttSize;
+    tt_resize(e, settings.ttSize);
   }
 
   if (delayedSettings.clear) {
     delayedSettings.clear = false;
-    search_clear();
+    search_clear(e);
   }
 
 #ifdef NNUE
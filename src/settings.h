@@ -6,6 +6,8 @@
 struct settings {
   NodeMask mask;
   size_t ttSize;
+  size_t memoryBudget;
+  size_t evalCacheSize;
   size_t numThreads;
   bool numaEnabled;
   bool largePages;
@@ -20,10 +20,13 @@
 
 #include <assert.h>
 
+#include "engine.h"
+#include "evaluate.h"
 #include "material.h"
 #include "movegen.h"
 #include "movepick.h"
 #include "numa.h"
+#include "params.h"
 #include "pawns.h"
 #include "search.h"
 #include "settings.h"
@@ -40,16 +43,22 @@ static void thread_idle_loop(Position *pos);
 #endif
 
 // Global objects
-ThreadPool Threads;
-MainThread mainThread;
-CounterMoveHistoryStat **cmhTables = NULL;
-int numCmhTables = 0;
+Engine DefaultEngine;
+
+// ThreadArgs is handed by thread_create() to the new thread. It lives on
+// the creator's stack, which waits until the thread has read it.
+
+struct ThreadArgs {
+  Engine *engine;
+  int idx;
+};
 
 // thread_init() is where a search thread starts and initialises itself.
 
 static THREAD_FUNC thread_init(void *arg)
 {
-  int idx = (intptr_t)arg;
+  Engine *e = ((struct ThreadArgs *)arg)->engine;
+  int idx = ((struct ThreadArgs *)arg)->idx;
 
   int node;
   if (settings.numaEnabled)
@@ -62,22 +71,23 @@ static THREAD_FUNC thread_init(void *arg)
 #else
   int t = node;
 #endif
-  if (t >= numCmhTables) {
-    int old = numCmhTables;
-    numCmhTables = t + 16;
-    cmhTables = realloc(cmhTables,
-        numCmhTables * sizeof(CounterMoveHistoryStat *));
-    while (old < numCmhTables)
-      cmhTables[old++] = NULL;
+  if (t >= e->numCmhTables) {
+    int old = e->numCmhTables;
+    e->numCmhTables = t + 16;
+    e->cmhTables = realloc(e->cmhTables,
+        e->numCmhTables * sizeof(CounterMoveHistoryStat *));
+    while (old < e->numCmhTables)
+      e->cmhTables[old++] = NULL;
   }
-  if (!cmhTables[t]) {
+  if (!e->cmhTables[t]) {
     if (settings.numaEnabled)
-      cmhTables[t] = numa_alloc(sizeof(CounterMoveHistoryStat));
+      e->cmhTables[t] = numa_alloc(sizeof(CounterMoveHistoryStat));
     else
-      cmhTables[t] = calloc(sizeof(CounterMoveHistoryStat), 1);
+      e->cmhTables[t] = calloc(sizeof(CounterMoveHistoryStat), 1);
     for (int j = 0; j < 7; j++)
       for (int k = 0; k < 64; k++)
-        (*cmhTables[t])[0][0][j][k] = CounterMovePruneThreshold - 1;
+        (*e->cmhTables[t])[0][0][j][k] =
+            engine_param(e, counterMoveHistoryThreshold);
   }
 
   Position *pos;
@@ -85,31 +95,46 @@ static THREAD_FUNC thread_init(void *arg)
   if (settings.numaEnabled) {
     pos = numa_alloc(sizeof(Position));
 #ifndef NNUE_PURE
-    pos->pawnTable = numa_alloc(PAWN_ENTRIES * sizeof(PawnEntry));
-    pos->materialTable = numa_alloc(8192 * sizeof(MaterialEntry));
+    pos->pawnTable = numa_alloc(e->pawnEntries * sizeof(PawnEntry));
+    pos->materialTable =
+        numa_alloc(e->materialEntries * sizeof(MaterialHashEntry));
+    if (e->evalEntries)
+      pos->evalCache = numa_alloc(eval_cache_size(e->evalEntries));
+    pos->sliderAttacks = numa_alloc(SLIDER_ATTACKS_SIZE);
 #endif
     pos->counterMoves = numa_alloc(sizeof(CounterMoveStat));
     pos->mainHistory = numa_alloc(sizeof(ButterflyHistory));
     pos->captureHistory = numa_alloc(sizeof(CapturePieceToHistory));
     pos->rootMoves = numa_alloc(sizeof(RootMoves));
-    pos->stackAllocation = numa_alloc(63 + (MAX_PLY + 110) * sizeof(Stack));
-    pos->moveList = numa_alloc(10000 * sizeof(ExtMove));
+    pos->stackAllocation = numa_alloc(STACK_ALLOC_SIZE);
+    pos->moveList = numa_alloc(MOVE_LIST_SIZE);
   } else {
     pos = calloc(sizeof(Position), 1);
 #ifndef NNUE_PURE
-    pos->pawnTable = calloc(PAWN_ENTRIES * sizeof(PawnEntry), 1);
-    pos->materialTable = calloc(1024 * sizeof(MaterialEntry), 1);
+    pos->pawnTable = calloc(e->pawnEntries * sizeof(PawnEntry), 1);
+    pos->materialTable =
+        calloc(e->materialEntries * sizeof(MaterialHashEntry), 1);
+    if (e->evalEntries)
+      pos->evalCache = calloc(eval_cache_size(e->evalEntries), 1);
+    pos->sliderAttacks = calloc(SLIDER_ATTACKS_SIZE, 1);
 #endif
     pos->counterMoves = calloc(sizeof(CounterMoveStat), 1);
     pos->mainHistory = calloc(sizeof(ButterflyHistory), 1);
     pos->captureHistory = calloc(sizeof(CapturePieceToHistory), 1);
     pos->rootMoves = calloc(sizeof(RootMoves), 1);
-    pos->stackAllocation = calloc(63 + (MAX_PLY + 110) * sizeof(Stack), 1);
-    pos->moveList = calloc(10000 * sizeof(ExtMove), 1);
+    pos->stackAllocation = calloc(STACK_ALLOC_SIZE, 1);
+    pos->moveList = calloc(MOVE_LIST_SIZE, 1);
   }
   pos->stack = (Stack *)(((uintptr_t)pos->stackAllocation + 0x3f) & ~0x3f);
+#ifndef NNUE_PURE
+  pos->pawnMask = e->pawnEntries - 1;
+  pos->materialShift = 64 - msb(e->materialEntries);
+  if (pos->evalCache)
+    pos->evalCache->mask = e->evalEntries - 1;
+#endif
   pos->threadIdx = idx;
-  pos->counterMoveHistory = cmhTables[t];
+  pos->engine = e;
+  pos->counterMoveHistory = e->cmhTables[t];
 
   atomic_store(&pos->resetCalls, false);
   pos->selDepth = pos->callsCnt = 0;
@@ -119,21 +144,21 @@ static THREAD_FUNC thread_init(void *arg)
   pthread_mutex_init(&pos->mutex, NULL);
   pthread_cond_init(&pos->sleepCondition, NULL);
 
-  Threads.pos[idx] = pos;
+  e->threads.pos[idx] = pos;
 
-  pthread_mutex_lock(&Threads.mutex);
-  Threads.initializing = false;
-  pthread_cond_signal(&Threads.sleepCondition);
-  pthread_mutex_unlock(&Threads.mutex);
+  pthread_mutex_lock(&e->threads.mutex);
+  e->threads.initializing = false;
+  pthread_cond_signal(&e->threads.sleepCondition);
+  pthread_mutex_unlock(&e->threads.mutex);
 
 #else // Windows
 
   pos->startEvent = CreateEvent(NULL, FALSE, FALSE, NULL);
   pos->stopEvent = CreateEvent(NULL, FALSE, FALSE, NULL);
 
-  Threads.pos[idx] = pos;
+  e->threads.pos[idx] = pos;
 
-  SetEvent(Threads.event);
+  SetEvent(e->threads.event);
 
 #endif
 
@@ -144,8 +169,10 @@ static THREAD_FUNC thread_init(void *arg)
 
 // thread_create() launches a new thread.
 
-static void thread_create(int idx)
+static void thread_create(Engine *e, int idx)
 {
+  struct ThreadArgs args = { e, idx };
+
 #ifndef _WIN32
 
   pthread_t thread;
@@ -155,24 +182,23 @@ static void thread_create(int idx)
   pthread_attr_init(&attr);
   pthread_attr_setstacksize(&attr, 128 * 1024);
 
-  Threads.initializing = true;
-  pthread_mutex_lock(&Threads.mutex);
-  pthread_create(&thread, &attr, thread_init, (void *)(intptr_t)idx);
-  while (Threads.initializing)
-    pthread_cond_wait(&Threads.sleepCondition, &Threads.mutex);
-  pthread_mutex_unlock(&Threads.mutex);
+  e->threads.initializing = true;
+  pthread_mutex_lock(&e->threads.mutex);
+  pthread_create(&thread, &attr, thread_init, &args);
+  while (e->threads.initializing)
+    pthread_cond_wait(&e->threads.sleepCondition, &e->threads.mutex);
+  pthread_mutex_unlock(&e->threads.mutex);
 
   pthread_attr_destroy(&attr);
 
 #else
 
-  HANDLE thread = CreateThread(NULL, 0, thread_init, (void *)(intptr_t)idx,
-      0 , NULL);
-  WaitForSingleObject(Threads.event, INFINITE);
+  HANDLE thread = CreateThread(NULL, 0, thread_init, &args, 0 , NULL);
+  WaitForSingleObject(e->threads.event, INFINITE);
 
 #endif
 
-  Threads.pos[idx]->nativeThread = thread;
+  e->threads.pos[idx]->nativeThread = thread;
 }
 
 
@@ -198,20 +224,26 @@ static void thread_destroy(Position *pos)
 
   if (settings.numaEnabled) {
 #ifndef NNUE_PURE
-    numa_free(pos->pawnTable, PAWN_ENTRIES * sizeof(PawnEntry));
-    numa_free(pos->materialTable, 8192 * sizeof(MaterialEntry));
+    numa_free(pos->pawnTable, (pos->pawnMask + 1) * sizeof(PawnEntry));
+    numa_free(pos->materialTable,
+        (1ULL << (64 - pos->materialShift)) * sizeof(MaterialHashEntry));
+    if (pos->evalCache)
+      numa_free(pos->evalCache, eval_cache_size(pos->evalCache->mask + 1));
+    numa_free(pos->sliderAttacks, SLIDER_ATTACKS_SIZE);
 #endif
     numa_free(pos->counterMoves, sizeof(CounterMoveStat));
     numa_free(pos->mainHistory, sizeof(ButterflyHistory));
     numa_free(pos->captureHistory, sizeof(CapturePieceToHistory));
     numa_free(pos->rootMoves, sizeof(RootMoves));
-    numa_free(pos->stackAllocation, 63 + (MAX_PLY + 110) * sizeof(Stack));
-    numa_free(pos->moveList, 10000 * sizeof(ExtMove));
+    numa_free(pos->stackAllocation, STACK_ALLOC_SIZE);
+    numa_free(pos->moveList, MOVE_LIST_SIZE);
     numa_free(pos, sizeof(Position));
   } else {
 #ifndef NNUE_PURE
     free(pos->pawnTable);
     free(pos->materialTable);
+    free(pos->evalCache);
+    free(pos->sliderAttacks);
 #endif
     free(pos->counterMoves);
     free(pos->mainHistory);
@@ -245,7 +277,7 @@ void thread_wait_until_sleeping(Position *pos)
 #endif
 
   if (pos->threadIdx == 0)
-    Threads.searching = false;
+    pos->engine->threads.searching = false;
 }
 
 
@@ -317,18 +349,30 @@ static void thread_idle_loop(Position *pos)
 
 #endif
 
+#ifdef TUNE
+    params_load(&pos->engine->params);
+#endif
+
     if (pos->action == THREAD_EXIT) {
 
       break;
 
     } else if (pos->action == THREAD_TT_CLEAR) {
 
-      tt_clear_worker(pos->threadIdx);
+      tt_clear_worker(pos);
+
+    } else if (pos->action == THREAD_TT_RESIZE) {
+
+      tt_resize_worker(pos);
+
+    } else if (pos->action == THREAD_PERFT) {
+
+      perft_worker(pos);
 
     } else {
 
       if (pos->threadIdx == 0)
-        mainthread_search();
+        mainthread_search(pos);
       else
         thread_search(pos);
 
@@ -346,31 +390,40 @@ static void thread_idle_loop(Position *pos)
 
 
 // threads_init() creates and launches requested threads that will go
-// immediately to sleep. We cannot use a constructor because Threads is a
-// static object and we need a fully initialized engine at this point due to
-// allocation of Endgames in the Thread constructor.
+// immediately to sleep. We cannot use a constructor because the thread pool
+// is part of a static object and we need a fully initialized engine at this
+// point due to allocation of Endgames in the Thread constructor.
 
-void threads_init(void)
+void threads_init(Engine *e)
 {
 #ifndef _WIN32
 
-  pthread_mutex_init(&Threads.mutex, NULL);
-  pthread_cond_init(&Threads.sleepCondition, NULL);
+  pthread_mutex_init(&e->threads.mutex, NULL);
+  pthread_cond_init(&e->threads.sleepCondition, NULL);
 
 #else
 
-  Threads.event = CreateEvent(NULL, FALSE, FALSE, NULL);
+  e->threads.event = CreateEvent(NULL, FALSE, FALSE, NULL);
 
 #endif
 
-#ifdef NUMA
+  LOCK_INIT(e->threads.lock);
 
-  numa_init();
+#ifdef TUNE
+  e->params = DefaultParams;
+#endif
 
+#ifndef NNUE_PURE
+  if (!e->pawnEntries)
+    e->pawnEntries = PAWN_ENTRIES;
+  if (!e->materialEntries)
+    e->materialEntries = MATERIAL_ENTRIES;
+  e->evalEntries = eval_cache_entries(EVAL_CACHE_KB);
 #endif
 
-  Threads.numThreads = 1;
-  thread_create(0);
+  e->threads.numThreads = 1;
+  thread_create(e, 0);
+  search_init(e);
 }
 
 
@@ -378,24 +431,20 @@ void threads_init(void)
 // done in destructor because threads must be terminated before deleting
 // any static objects while still in main().
 
-void threads_exit(void)
+void threads_exit(Engine *e)
 {
-  threads_set_number(0);
+  threads_set_number(e, 0);
+
+  LOCK_DESTROY(e->threads.lock);
 
 #ifndef _WIN32
 
-  pthread_cond_destroy(&Threads.sleepCondition);
-  pthread_mutex_destroy(&Threads.mutex);
+  pthread_cond_destroy(&e->threads.sleepCondition);
+  pthread_mutex_destroy(&e->threads.mutex);
 
 #else
 
-  CloseHandle(Threads.event);
-
-#endif
-
-#ifdef NUMA
-
-  numa_exit();
+  CloseHandle(e->threads.event);
 
 #endif
 }
@@ -404,51 +453,119 @@ void threads_exit(void)
 // threads_set_number() creates/destroys threads to match the requested
 // number.
 
-void threads_set_number(int num)
+void threads_set_number(Engine *e, int num)
 {
-  while (Threads.numThreads < num)
-    thread_create(Threads.numThreads++);
+  while (e->threads.numThreads < num)
+    thread_create(e, e->threads.numThreads++);
 
-  while (Threads.numThreads > num)
-    thread_destroy(Threads.pos[--Threads.numThreads]);
+  while (e->threads.numThreads > num)
+    thread_destroy(e->threads.pos[--e->threads.numThreads]);
 
-  search_init();
+  search_init(e);
 
-  if (num == 0 && numCmhTables > 0) {
-    for (int i = 0; i < numCmhTables; i++)
-      if (cmhTables[i]) {
+  if (num == 0 && e->numCmhTables > 0) {
+    for (int i = 0; i < e->numCmhTables; i++)
+      if (e->cmhTables[i]) {
         if (settings.numaEnabled)
-          numa_free(cmhTables[i], sizeof(CounterMoveHistoryStat));
+          numa_free(e->cmhTables[i], sizeof(CounterMoveHistoryStat));
         else
-          free(cmhTables[i]);
+          free(e->cmhTables[i]);
       }
-    free(cmhTables);
-    cmhTables = NULL;
-    numCmhTables = 0;
+    free(e->cmhTables);
+    e->cmhTables = NULL;
+    e->numCmhTables = 0;
   }
 
   if (num == 0)
-    Threads.searching = false;
+    e->threads.searching = false;
 }
 
 
 // threads_nodes_searched() returns the number of nodes searched.
 
-uint64_t threads_nodes_searched(void)
+uint64_t threads_nodes_searched(Engine *e)
 {
   uint64_t nodes = 0;
-  for (int idx = 0; idx < Threads.numThreads; idx++)
-    nodes += Threads.pos[idx]->nodes;
+  for (int idx = 0; idx < e->threads.numThreads; idx++)
+    nodes += e->threads.pos[idx]->nodes;
   return nodes;
 }
 
 
 // threads_tb_hits() returns the number of TB hits.
 
-uint64_t threads_tb_hits(void)
+uint64_t threads_tb_hits(Engine *e)
+{
+  uint64_t hits = 0;
+  for (int idx = 0; idx < e->threads.numThreads; idx++)
+    hits += e->threads.pos[idx]->tbHits;
+  return hits;
+}
+
+
+// threads_tt_hits() returns the number of TT hits in the main search and
+// quiescence search and stores the number of TT probes in *probes.
+
+uint64_t threads_tt_hits(Engine *e, uint64_t *probes)
 {
   uint64_t hits = 0;
-  for (int idx = 0; idx < Threads.numThreads; idx++)
-    hits += Threads.pos[idx]->tbHits;
+  *probes = 0;
+  for (int idx = 0; idx < e->threads.numThreads; idx++) {
+    hits += e->threads.pos[idx]->ttHits;
+    *probes += e->threads.pos[idx]->ttProbes;
+  }
   return hits;
 }
+
+#ifndef NNUE_PURE
+// threads_eval_hits() returns the number of evaluation cache hits and
+// stores the number of probes in *probes.
+
+uint64_t threads_eval_hits(Engine *e, uint64_t *probes)
+{
+  uint64_t hits = 0;
+  *probes = 0;
+  for (int idx = 0; idx < e->threads.numThreads; idx++) {
+    EvalCache *ec = e->threads.pos[idx]->evalCache;
+    if (ec) {
+      hits += ec->hits;
+      *probes += ec->probes;
+    }
+  }
+  return hits;
+}
+#endif
+
+#ifdef TT_STATS
+// threads_tt_stats() adds the TT counters of all threads to *stats.
+
+void threads_tt_stats(Engine *e, TTStats *stats)
+{
+  uint64_t *sum = (uint64_t *)stats;
+  for (int idx = 0; idx < e->threads.numThreads; idx++) {
+    const uint64_t *cnt = (const uint64_t *)&e->threads.pos[idx]->ttStats;
+    for (size_t i = 0; i < sizeof(TTStats) / sizeof(uint64_t); i++)
+      sum[i] += cnt[i];
+  }
+}
+#endif
+
+
+// thread_memory() returns the number of bytes allocated by a search thread
+// whose pawn and material tables have the given number of entries. The
+// counter move history tables are shared and not included.
+
+size_t thread_memory(int pawnEntries, int materialEntries)
+{
+  size_t bytes =  sizeof(Position) + MOVE_LIST_SIZE + STACK_ALLOC_SIZE
+                + sizeof(CounterMoveStat) + sizeof(ButterflyHistory)
+                + sizeof(CapturePieceToHistory) + sizeof(RootMoves);
+#ifndef NNUE_PURE
+  bytes +=  pawnEntries * sizeof(PawnEntry)
+          + materialEntries * sizeof(MaterialHashEntry)
+          + SLIDER_ATTACKS_SIZE;
+#else
+  (void)pawnEntries, (void)materialEntries;
+#endif
+  return bytes;
+}
@@ -47,9 +47,17 @@
 #endif
 
 enum {
-  THREAD_SLEEP, THREAD_SEARCH, THREAD_TT_CLEAR, THREAD_EXIT, THREAD_RESUME
+  THREAD_SLEEP, THREAD_SEARCH, THREAD_TT_CLEAR, THREAD_TT_RESIZE,
+  THREAD_PERFT, THREAD_EXIT,
+  THREAD_RESUME
 };
 
+// Sizes in bytes of the search stack and the move list that each search
+// thread allocates.
+#define STACK_ALLOC_SIZE (63 + (MAX_PLY + 110) * sizeof(Stack))
+#define MOVE_LIST_SIZE (10000 * sizeof(ExtMove))
+#define SLIDER_ATTACKS_SIZE ((MAX_PLY + 110) * sizeof(SliderAttacks))
+
 void thread_search(Position *pos);
 void thread_wake_up(Position *pos, int action);
 void thread_wait_until_sleeping(Position *pos);
@@ -66,9 +74,7 @@ struct MainThread {
 
 typedef struct MainThread MainThread;
 
-extern MainThread mainThread;
-
-void mainthread_search(void);
+void mainthread_search(Position *pos);
 
 
 // ThreadPool struct handles all the threads-related stuff like init,
@@ -92,21 +98,20 @@ struct ThreadPool {
 
 typedef struct ThreadPool ThreadPool;
 
-void threads_init(void);
-void threads_exit(void);
-void threads_start_thinking(Position *pos, LimitsType *);
-void threads_set_number(int num);
-uint64_t threads_nodes_searched(void);
-uint64_t threads_tb_hits(void);
-
-extern ThreadPool Threads;
-
-INLINE Position *threads_main(void)
-{
-  return Threads.pos[0];
-}
+void threads_init(Engine *e);
+void threads_exit(Engine *e);
+void threads_set_number(Engine *e, int num);
+uint64_t threads_nodes_searched(Engine *e);
+uint64_t threads_tb_hits(Engine *e);
+uint64_t threads_tt_hits(Engine *e, uint64_t *probes);
+#ifndef NNUE_PURE
+uint64_t threads_eval_hits(Engine *e, uint64_t *probes);
+#endif
+#ifdef TT_STATS
+void threads_tt_stats(Engine *e, TTStats *stats);
+#endif
+size_t thread_memory(int pawnEntries, int materialEntries);
 
-extern CounterMoveHistoryStat **cmhTables;
-extern int numCmhTables;
+#define threads_main(e) ((e)->threads.pos[0])
 
 #endif
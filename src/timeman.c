@@ -21,18 +21,18 @@
 #include <float.h>
 #include <math.h>
 
+#include "engine.h"
+#include "params.h"
 #include "search.h"
 #include "timeman.h"
 #include "uci.h"
 
-struct TimeManagement Time; // Our global time management struct
-
 // tm_init() is called at the beginning of the search and calculates the
 // time bounds allowed for the current game ply. We currently support:
 // 1) x basetime (+z increment)
 // 2) x moves in y seconds (+z increment)
 
-void time_init(Color us, int ply)
+void time_init(Engine *e, Color us, int ply)
 {
   int moveOverhead    = 10;  // option_value(OPT_MOVE_OVERHEAD);
   int slowMover       = 100;  // option_value(OPT_SLOW_MOVER);
@@ -47,22 +47,22 @@ void time_init(Color us, int ply)
   // WARNING: Given npms (nodes per millisecond) must be much lower then
   // the real engine speed to avoid time losses.
   if (npmsec) {
-    if (!Time.availableNodes) // Only once at game start
-      Time.availableNodes = npmsec * Limits.time[us]; // Time is in msec
+    if (!e->time.availableNodes) // Only once at game start
+      e->time.availableNodes = npmsec * e->limits.time[us]; // Time is in msec
 
     // Convert from millisecs to nodes
-    Limits.time[us] = (int)Time.availableNodes;
-    Limits.inc[us] *= npmsec;
-    Limits.npmsec = npmsec;
+    e->limits.time[us] = (int)e->time.availableNodes;
+    e->limits.inc[us] *= npmsec;
+    e->limits.npmsec = npmsec;
   }
 
-  Time.startTime = Limits.startTime;
+  e->time.startTime = e->limits.startTime;
 
   // Maximum move horizon of 50 moves
-  int mtg = Limits.movestogo ? min(Limits.movestogo, 50) : 50;
+  int mtg = e->limits.movestogo ? min(e->limits.movestogo, 50) : 50;
 
   // Make sure that timeLeft > 0 since we may use it as a divisor
-  TimePoint timeLeft = max(1, Limits.time[us] + Limits.inc[us] * (mtg - 1) - moveOverhead * (2 + mtg));
+  TimePoint timeLeft = max(1, e->limits.time[us] + e->limits.inc[us] * (mtg - 1) - moveOverhead * (2 + mtg));
 
   // A user may scale time usage by setting UCI option "Slow Mover".
   // Default is 100 and changing this value will probably lose Elo.
@@ -71,28 +71,38 @@ void time_init(Color us, int ply)
   // x basetime (+z increment)
   // If there is a healthy increment, timeLeft can exceed actual available
   // game time for the current move, so also cap to 20% of available game time.
-  if (Limits.movestogo == 0) {
-    optScale = min(0.0084 + pow(ply + 3.0, 0.5) * 0.0042,
-                    0.2 * Limits.time[us] / (double)timeLeft);
-    maxScale = min(7.0, 4.0 + ply / 12.0);
+  // optExtra boosts optScale with a large increment, while optConstant and
+  // maxConstant depend on the remaining time. With the default parameters
+  // none of them changes with the time control.
+  if (e->limits.movestogo == 0) {
+    double time = max(1, e->limits.time[us]);
+    double optExtra = clamp(optExtraA / 100.0 + optExtraB / 10.0 * e->limits.inc[us] / time,
+                            optExtraA / 100.0, optExtraC / 100.0);
+    double optConstant = min(optConstantA / 100000.0 + optConstantB / 100000.0 * log10(time / 1000.0),
+                             optConstantC / 10000.0);
+    double maxConstant = max(maxConstantA / 100.0 + maxConstantB / 100.0 * log10(time / 1000.0),
+                             maxConstantC / 100.0);
+    optScale = min(optScaleA / 10000.0 + pow(ply + optScaleB / 10.0, optScaleC / 100.0) * optConstant,
+                    optScaleD / 100.0 * e->limits.time[us] / (double)timeLeft) * optExtra;
+    maxScale = min(maxScaleA / 10.0, maxConstant + ply / (maxScaleB / 10.0));
   }
   // x moves in y seconds (+z increment)
   else {
     optScale = min((0.8 + ply / 120.0) / mtg,
-                     0.8 * Limits.time[us] / (double)timeLeft);
+                     0.8 * e->limits.time[us] / (double)timeLeft);
     maxScale = min(6.3, 1.5 + 0.11 * mtg);
   }
 
   // Never use more than 80% of the available time for this move
-  Time.optimumTime = optScale * timeLeft;
-  Time.maximumTime = min(0.8 * Limits.time[us] - moveOverhead, maxScale * Time.optimumTime);
+  e->time.optimumTime = optScale * timeLeft;
+  e->time.maximumTime = min(maximumTimeA / 100.0 * e->limits.time[us] - moveOverhead, maxScale * e->time.optimumTime) - maximumTimeB;
 
-  if (use_time_management()) {
-    int strength = log(max(1, (int)(Time.optimumTime * Threads.numThreads  / 10))) * 60;
-    Time.tempoNNUE = clamp((strength + 264) / 24, 18, 30);
+  if (use_time_management(e)) {
+    int strength = log(max(1, (int)(e->time.optimumTime * e->threads.numThreads  / 10))) * 60;
+    e->time.tempoNNUE = clamp((strength + 264) / 24, 18, 30);
   } else
-    Time.tempoNNUE = 28; // default for no time given
+    e->time.tempoNNUE = 28; // default for no time given
 
   // if (option_value(OPT_PONDER))
-  //   Time.optimumTime += Time.optimumTime / 4;
+  //   e->time.optimumTime += e->time.optimumTime / 4;
 }
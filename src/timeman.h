@@ -36,17 +36,11 @@ struct TimeManagement {
   int tempoNNUE;
 };
 
-extern struct TimeManagement Time;
+typedef struct TimeManagement TimeManagement;
 
-void time_init(Color us, int ply);
+void time_init(Engine *e, Color us, int ply);
 
-#define time_optimum() Time.optimumTime
-#define time_maximum() Time.maximumTime
-
-INLINE TimePoint time_elapsed(void)
-{
-  return Limits.npmsec ? (int64_t)threads_nodes_searched()
-                       : now() - Time.startTime;
-}
+#define time_optimum(e) ((e)->time.optimumTime)
+#define time_maximum(e) ((e)->time.maximumTime)
 
 #endif
@@ -27,36 +27,55 @@
 
 #include "bitboard.h"
 #include "numa.h"
+#include "engine.h"
 #include "settings.h"
 #include "thread.h"
 #include "tt.h"
 #include "types.h"
 #include "uci.h"
 
-TranspositionTable TT; // Our global transposition table
-
 // tt_free() frees the allocated transposition table memory.
 
-void tt_free(void)
+void tt_free(TranspositionTable *tt)
 {
-  if (TT.table)
-    free_memory(&TT.alloc);
-  TT.table = NULL;
+  if (tt->table)
+    free_memory(&tt->alloc);
+  tt->table = NULL;
 }
 
 
-// tt_allocate() allocates the transposition table, measured in megabytes.
+// tt_wipe() initialises the entire transposition table to zero.
 
-void tt_allocate(size_t kbSize)
+static void tt_wipe(Engine *e)
 {
-  TT.clusterCount = kbSize * 1024 / sizeof(Cluster);
-  size_t size = TT.clusterCount * sizeof(Cluster);
+  // We let search threads clear the table in parallel. In NUMA mode,
+  // this has the beneficial effect of spreading the TT over all nodes.
+
+  if (e->tt.table) {
+    e->tt.epoch16 = 0;
+    for (int idx = 0; idx < e->threads.numThreads; idx++)
+      thread_wake_up(e->threads.pos[idx], THREAD_TT_CLEAR);
+    for (int idx = 0; idx < e->threads.numThreads; idx++)
+      thread_wait_until_sleeping(e->threads.pos[idx]);
+  }
+}
+
+
+// tt_allocate() allocates the engine's transposition table, measured in
+// kilobytes.
+
+void tt_allocate(Engine *e, size_t kbSize)
+{
+  TranspositionTable *tt = &e->tt;
+
+  tt->clusterCount = kbSize * 1024 / sizeof(Cluster);
+  size_t size = tt->clusterCount * sizeof(Cluster);
 
-  TT.table = NULL;
+  tt->table = NULL;
   if (settings.largePages) {
-    TT.table = allocate_memory(size, true, &TT.alloc);
+    tt->table = allocate_memory(size, true, &tt->alloc);
 #if !defined(__linux__)
-    if (!TT.table)
+    if (!tt->table)
       printf("info string Unable to allocate large pages for the "
              "transposition table.\n");
     else
@@ -64,14 +83,14 @@ void tt_allocate(size_t kbSize)
     fflush(stdout);
 #endif
   }
-  if (!TT.table)
-    TT.table = allocate_memory(size, false, &TT.alloc);
-  if (!TT.table)
+  if (!tt->table)
+    tt->table = allocate_memory(size, false, &tt->alloc);
+  if (!tt->table)
     goto failed;
 
   // Clear the TT table to page in the memory immediately. This avoids
   // an initial slow down during the first second or minutes of the search.
-  tt_clear();
+  tt_wipe(e);
   return;
 
 failed:
@@ -81,36 +100,132 @@ failed:
 }
 
 
-// tt_clear() initialises the entire transposition table to zero.
+// tt_clear() empties the transposition table. Where clusters carry an epoch
+// this takes constant time, and the table is only wiped when the epoch
+// wraps around.
 
-void tt_clear(void)
+void tt_clear(Engine *e)
 {
-  // We let search threads clear the table in parallel. In NUMA mode,
-  // this has the beneficial effect of spreading the TT over all nodes.
-
-  if (TT.table) {
-    for (int idx = 0; idx < Threads.numThreads; idx++)
-      thread_wake_up(Threads.pos[idx], THREAD_TT_CLEAR);
-    for (int idx = 0; idx < Threads.numThreads; idx++)
-      thread_wait_until_sleeping(Threads.pos[idx]);
-  }
+#ifndef TT_COMPACT
+  if (e->tt.table && ++e->tt.epoch16 != 0)
+    return;
+#endif
+  tt_wipe(e);
 }
 
-void tt_clear_worker(int idx)
+void tt_clear_worker(Position *pos)
 {
+  TranspositionTable *tt = &pos->engine->tt;
+  int numThreads = pos->engine->threads.numThreads;
+
   // Find out which part of the TT this thread should clear.
   // To each thread we assign a number of 2MB blocks.
 
-  size_t total = TT.clusterCount * sizeof(Cluster);
-  size_t slice = (total + Threads.numThreads - 1) / Threads.numThreads;
+  size_t total = tt->clusterCount * sizeof(Cluster);
+  size_t slice = (total + numThreads - 1) / numThreads;
   size_t blocks = (slice + (2 * 1024 * 1024) - 1) / (2 * 1024 * 1024);
-  size_t begin = idx * blocks * (2 * 1024 * 1024);
+  size_t begin = pos->threadIdx * blocks * (2 * 1024 * 1024);
   size_t end = begin + blocks * (2 * 1024 * 1024);
   begin = min(begin, total);
   end = min(end, total);
 
   // Now clear that part
-  memset((uint8_t *)TT.table + begin, 0, end - begin);
+  memset((uint8_t *)tt->table + begin, 0, end - begin);
+}
+
+
+// replace_value() returns the depth of an entry minus 8 times its age.
+// Due to our packed storage format for generation and its cyclic nature we
+// add 263 (256 is the modulus plus 7 to keep the unrelated lowest three
+// bits from affecting the result) to calculate the entry age correctly even
+// after generation8 overflows into the next cycle.
+
+INLINE int replace_value(TranspositionTable *tt, const TTEntry *tte)
+{
+  return tte->depth8 - ((263 + tt->generation8 - tte->genBound8) & 0xF8);
+}
+
+
+// tt_resize() changes the size of the engine's transposition table to
+// kbSize kilobytes. The search threads carry the entries of the old table
+// over to the new one before the old table is freed.
+
+void tt_resize(Engine *e, size_t kbSize)
+{
+  TranspositionTable old = e->tt;
+
+  tt_allocate(e, kbSize);
+  if (!old.table)
+    return;
+
+  e->tt.resizeFrom = &old;
+  for (int idx = 0; idx < e->threads.numThreads; idx++)
+    thread_wake_up(e->threads.pos[idx], THREAD_TT_RESIZE);
+  for (int idx = 0; idx < e->threads.numThreads; idx++)
+    thread_wait_until_sleeping(e->threads.pos[idx]);
+  e->tt.resizeFrom = NULL;
+
+  tt_free(&old);
+}
+
+#if defined(__GNUC__) && defined(IS_64BIT)
+__extension__ typedef unsigned __int128 wide_t;
+#else
+typedef uint64_t wide_t; // Cluster counts stay below 2^32
+#endif
+
+// tt_resize_worker() moves the entries of the old table that can belong to
+// this thread's share of the new clusters. Only the high bits of a key pick
+// its cluster and they are not stored, so an old cluster maps to a range of
+// new ones and its entries are offered to all of them. Each new cluster
+// keeps the most valuable entries offered to it.
+
+void tt_resize_worker(Position *pos)
+{
+  TranspositionTable *tt = &pos->engine->tt;
+  TranspositionTable *src = tt->resizeFrom;
+  int numThreads = pos->engine->threads.numThreads;
+  size_t n = tt->clusterCount, m = src->clusterCount;
+  size_t begin = n * pos->threadIdx / numThreads;
+  size_t end = n * (pos->threadIdx + 1) / numThreads;
+
+  if (begin == end)
+    return;
+
+  size_t first = (wide_t)begin * m / n;
+  size_t last = ((wide_t)end * m + n - 1) / n;
+  last = last < m ? last : m;
+
+  for (size_t s = first; s < last; s++) {
+    Cluster *from = &src->table[s];
+#ifndef TT_COMPACT
+    if (from->epoch16 != src->epoch16)
+      continue;
+#endif
+    size_t lo = (wide_t)s * n / m;
+    size_t hi = ((wide_t)(s + 1) * n + m - 1) / m;
+    lo = lo > begin ? lo : begin;
+    hi = hi < end ? hi : end;
+
+    for (int i = 0; i < ClusterSize; i++) {
+      const TTEntry *tte = &from->entry[i];
+      if (!tte->depth8)
+        continue;
+
+      for (size_t d = lo; d < hi; d++) {
+        TTEntry *replace = tt->table[d].entry;
+        for (int j = 1; j < ClusterSize && replace->depth8; j++) {
+          TTEntry *cand = &tt->table[d].entry[j];
+          if (   !cand->depth8
+              || replace_value(tt, replace) > replace_value(tt, cand))
+            replace = cand;
+        }
+        if (   !replace->depth8
+            || replace_value(tt, replace) < replace_value(tt, tte))
+          *replace = *tte;
+      }
+    }
+  }
 }
 
 
@@ -120,32 +235,50 @@ void tt_clear_worker(int idx)
 // TTEntry to be replaced later. The replace value of an entry is
 // calculated as its depth minus 8 times its relative age. TTEntry t1 is
 // considered more valuable than TTEntry t2 if its replace value is greater
-// than that of t2.
+// than that of t2. In TT_LOCKLESS builds a copy of the entry is checked
+// against the key and left in *data for the caller to read.
 
-TTEntry *tt_probe(Key key, bool *found)
+TTEntry *tt_probe(TranspositionTable *tt, Key key, bool *found, TTEntry *data)
 {
-  TTEntry *tte = tt_first_entry(key);
+  Cluster *cl = &tt->table[mul_hi64(key, tt->clusterCount)];
+  TTEntry *tte = cl->entry;
   uint16_t key16 = key; // Use the low 16 bits as key inside the cluster
 
-  for (int i = 0; i < ClusterSize; i++)
-    if (tte[i].key16 == key16 || !tte[i].depth8) {
-//      if ((tte[i].genBound8 & 0xF8) != TT.generation8 && tte[i].key16)
-      tte[i].genBound8 = TT.generation8 | (tte[i].genBound8 & 0x7); // Refresh
-      *found = tte[i].depth8;
+#ifndef TT_COMPACT
+  // Entries from before the last tt_clear() are empty
+  if (unlikely(cl->epoch16 != tt->epoch16)) {
+    memset(cl->entry, 0, sizeof(cl->entry));
+    cl->epoch16 = tt->epoch16;
+  }
+#endif
+
+  for (int i = 0; i < ClusterSize; i++) {
+#ifdef TT_LOCKLESS
+    // Verify a private copy, which is what the search will read
+    *data = tte[i];
+    const TTEntry *cur = data;
+#else
+    (void)data;
+    const TTEntry *cur = &tte[i];
+#endif
+    if (tte_key(cur) == key16 || !cur->depth8) {
+//      if ((tte[i].genBound8 & 0xF8) != tt->generation8 && tte[i].key16)
+      tte[i].genBound8 = tt->generation8 | (tte[i].genBound8 & 0x7); // Refresh
+      *found = cur->depth8;
       return &tte[i];
     }
+  }
 
   // Find an entry to be replaced according to the replacement strategy
   TTEntry *replace = tte;
   for (int i = 1; i < ClusterSize; i++)
-    // Due to our packed storage format for generation and its cyclic
-    // nature we add 263 (256 is the modulus plus 7 to keep the unrelated
-    // lowest three bits from affecting the result) to calculate the entry
-    // age correctly even after generation8 overflows into the next cycle.
-    if ( replace->depth8 - ((263 + TT.generation8 - replace->genBound8) & 0xF8)
-        >  tte[i].depth8 - ((263 + TT.generation8 -   tte[i].genBound8) & 0xF8))
+    if (replace_value(tt, replace) > replace_value(tt, &tte[i]))
       replace = &tte[i];
 
+#ifdef TT_LOCKLESS
+  // On a miss the copy describes the slot that is about to be replaced
+  *data = *replace;
+#endif
   *found = false;
   return replace;
 }
@@ -154,13 +287,169 @@ TTEntry *tt_probe(Key key, bool *found)
 // Returns an approximation of the hashtable occupation during a search. The
 // hash is x permill full, as per UCI protocol.
 
-int tt_hashfull(void)
+int tt_hashfull(TranspositionTable *tt)
 {
   int cnt = 0;
   for (int i = 0; i < 1000 / ClusterSize; i++) {
-    const TTEntry *tte = &TT.table[i].entry[0];
+#ifndef TT_COMPACT
+    if (tt->table[i].epoch16 != tt->epoch16)
+      continue;
+#endif
+    const TTEntry *tte = &tt->table[i].entry[0];
     for (int j = 0; j < ClusterSize; j++)
-      cnt += tte[j].depth8 && (tte[j].genBound8 & 0xf8) == TT.generation8;
+      cnt += tte[j].depth8 && (tte[j].genBound8 & 0xf8) == tt->generation8;
   }
   return cnt * 1000 / (ClusterSize * (1000 / ClusterSize));
 }
+
+
+#ifdef TT_STATS
+// tt_stats_print() reports the TT counters of one or more searches.
+
+void tt_stats_print(FILE *F, uint64_t probes, uint64_t hits, const TTStats *s)
+{
+  static const char *Depths[TTStatsDepths] = {
+    "<=0", "1-4", "5-8", "9-16", ">16"
+  };
+
+  uint64_t evicted = 0;
+  for (int d = 0; d < TTStatsDepths; d++)
+    for (int a = 0; a < TTStatsAges; a++)
+      evicted += s->evictions[d][a];
+
+  double p = probes ? 100.0 / probes : 0.0;
+  fprintf(F, "TT probes       : %" PRIu64 "\n", probes);
+  fprintf(F, "TT hits         : %" PRIu64 " (%.2f%%)\n", hits, hits * p);
+  fprintf(F, "TT collisions   : %" PRIu64 " (%.3f%%)\n", s->falseHits,
+             s->falseHits * p);
+  fprintf(F, "TT cutoffs      : %" PRIu64 " (%.2f%%)\n", s->cutoffs,
+             s->cutoffs * p);
+  fprintf(F, "TT empty slots  : %" PRIu64 " (%.2f%%)\n", s->fills,
+             s->fills * p);
+  fprintf(F, "TT evictions    : %" PRIu64 " (%.2f%%)\n", evicted,
+             evicted * p);
+  fprintf(F, "  %-6s %12s %12s %12s %12s\n", "depth", "age 0", "age 1",
+             "age 2", "age 3+");
+  for (int d = 0; d < TTStatsDepths; d++)
+    fprintf(F, "  %-6s %12" PRIu64 " %12" PRIu64 " %12" PRIu64 " %12" PRIu64
+               "\n", Depths[d], s->evictions[d][0], s->evictions[d][1],
+               s->evictions[d][2], s->evictions[d][3]);
+}
+#endif
+
+// A hash file starts with a header of one cache line, so that the clusters
+// that follow it stay aligned when the file is mapped. The format word ties
+// the file to the cluster layout of the build that wrote it.
+
+#define HASH_MAGIC "CfishTT"
+
+enum {
+  HashFormat =  sizeof(Cluster) | ClusterSize << 8
+#ifdef TT_LOCKLESS
+              | 1 << 16
+#endif
+              | 1 << 24 // version
+};
+
+typedef union {
+  struct {
+    char magic[8];
+    uint32_t format;
+    uint16_t epoch16;
+    uint8_t generation8;
+    uint64_t clusterCount;
+  };
+  char padding[CacheLineSize];
+} HashFileHeader;
+
+// tt_save() writes the transposition table to a file. It returns false if
+// the file could not be written.
+
+bool tt_save(Engine *e, const char *name)
+{
+  TranspositionTable *tt = &e->tt;
+  HashFileHeader header;
+
+  memset(&header, 0, sizeof(header));
+  memcpy(header.magic, HASH_MAGIC, sizeof(HASH_MAGIC));
+  header.format = HashFormat;
+  header.epoch16 = tt->epoch16;
+  header.generation8 = tt->generation8;
+  header.clusterCount = tt->clusterCount;
+
+  FILE *F = fopen(name, "wb");
+  if (!F)
+    return false;
+  bool ok =   fwrite(&header, sizeof(header), 1, F) == 1
+           && fwrite(tt->table, sizeof(Cluster), tt->clusterCount, F)
+                == tt->clusterCount;
+  return fclose(F) == 0 && ok;
+}
+
+// tt_load() replaces the transposition table with the one saved in a file.
+// A table of the same size is mapped copy-on-write and used in place, so
+// that its pages are read from disk only when the search touches them.
+// Otherwise the search threads carry the saved entries over to the current
+// table as they do in tt_resize(). It returns false if the file is missing
+// or was written by a build with a different cluster layout.
+
+bool tt_load(Engine *e, const char *name)
+{
+  FD fd = open_file(name);
+  if (fd == FD_ERR)
+    return false;
+
+  map_t map = 0;
+  const HashFileHeader *header = NULL;
+  size_t size = file_size(fd);
+  if (size >= sizeof(HashFileHeader))
+    header = map_file(fd, &map);
+  if (   !header
+      || memcmp(header->magic, HASH_MAGIC, sizeof(HASH_MAGIC))
+      || header->format != HashFormat
+      || !header->clusterCount
+      || size != sizeof(HashFileHeader) + header->clusterCount * sizeof(Cluster))
+  {
+    unmap_file(header, map);
+    close_file(fd);
+    return false;
+  }
+
+  TranspositionTable *tt = &e->tt;
+  tt->generation8 = header->generation8;
+
+#ifndef _WIN32
+  if (header->clusterCount == tt->clusterCount) {
+    void *ptr = mmap(NULL, size, PROT_READ | PROT_WRITE, MAP_PRIVATE, fd, 0);
+    if (ptr != MAP_FAILED) {
+      tt_free(tt);
+      tt->alloc.ptr = ptr;
+      tt->alloc.size = size;
+      tt->table = (Cluster *)((char *)ptr + sizeof(HashFileHeader));
+      tt->epoch16 = header->epoch16;
+      unmap_file(header, map);
+      close_file(fd);
+      return true;
+    }
+  }
+#endif
+
+  TranspositionTable src = {
+    .clusterCount = header->clusterCount,
+    .table = (Cluster *)((char *)header + sizeof(HashFileHeader)),
+    .generation8 = header->generation8,
+    .epoch16 = header->epoch16
+  };
+
+  tt_wipe(e);
+  tt->resizeFrom = &src;
+  for (int idx = 0; idx < e->threads.numThreads; idx++)
+    thread_wake_up(e->threads.pos[idx], THREAD_TT_RESIZE);
+  for (int idx = 0; idx < e->threads.numThreads; idx++)
+    thread_wait_until_sleeping(e->threads.pos[idx]);
+  tt->resizeFrom = NULL;
+
+  unmap_file(header, map);
+  close_file(fd);
+  return true;
+}
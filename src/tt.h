@@ -34,6 +34,10 @@
 // move       16 bit
 // value      16 bit
 // eval value 16 bit
+//
+// When compiled with TT_COMPACT (make tt=compact or tt=compact8) the entry
+// drops the eval field and takes 8 bytes. Entries without a bound only
+// carry a static eval, so their value field holds the eval instead.
 
 struct TTEntry {
   uint16_t key16;
@@ -41,7 +45,9 @@ struct TTEntry {
   uint8_t  genBound8;
   uint16_t move16;
   int16_t  value16;
+#ifndef TT_COMPACT
   int16_t  eval16;
+#endif
 };
 
 typedef struct TTEntry TTEntry;
@@ -51,13 +57,28 @@ typedef struct TTEntry TTEntry;
 // entry contains information of exactly one position. The size of a
 // cluster should divide the size of a cache line size, to ensure that
 // clusters never cross cache lines. This ensures best cache performance,
-// as the cacheline is prefetched, as soon as possible.
+// as the cacheline is prefetched, as soon as possible. The compact layout
+// packs 4 entries in a 32-byte cluster, or 8 in a whole cache line with
+// TT_COMPACT8.
+//
+// The full layout uses the two bytes left in a cluster for the epoch of its
+// entries. tt_clear() only advances the table's epoch, and tt_probe() empties
+// a cluster from an older epoch the first time it touches it. The compact
+// layouts have no room for it and wipe the table on every clear.
 
+#if defined(TT_COMPACT8)
+enum { CacheLineSize = 64, ClusterSize = 8 };
+#elif defined(TT_COMPACT)
+enum { CacheLineSize = 64, ClusterSize = 4 };
+#else
 enum { CacheLineSize = 64, ClusterSize = 3 };
+#endif
 
 struct Cluster {
   TTEntry entry[ClusterSize];
-  char padding[2]; // Align to a divisor of the cache line size
+#ifndef TT_COMPACT
+  uint16_t epoch16; // Also aligns to a divisor of the cache line size
+#endif
 };
 
 typedef struct Cluster Cluster;
@@ -67,21 +88,55 @@ struct TranspositionTable {
   Cluster *table;
   alloc_t alloc;
   uint8_t generation8; // Size must be not bigger than TTEntry::genBound8
+  uint16_t epoch16;
+  struct TranspositionTable *resizeFrom; // Old table during tt_resize()
 };
 
 typedef struct TranspositionTable TranspositionTable;
 
-extern TranspositionTable TT;
+// In TT_LOCKLESS builds (make lockless=yes) key16 is stored XORed with a
+// checksum of the other fields, so that an entry torn by two threads
+// writing it at the same time no longer matches its key. The generation
+// bits are left out as tt_probe() refreshes them in place.
+
+#ifdef TT_LOCKLESS
+INLINE uint16_t tte_check(const TTEntry *tte)
+{
+  return  tte->move16 ^ (uint16_t)tte->value16
+#ifndef TT_COMPACT
+        ^ (uint16_t)tte->eval16
+#endif
+        ^ (uint16_t)(tte->depth8 | (tte->genBound8 & 0x7) << 8);
+}
+#else
+INLINE uint16_t tte_check(const TTEntry *tte)
+{
+  (void)tte;
+  return 0;
+}
+#endif
+
+INLINE uint16_t tte_key(const TTEntry *tte)
+{
+  return tte->key16 ^ tte_check(tte);
+}
 
-INLINE void tte_save(TTEntry *tte, Key k, Value v, bool pv, int b, Depth d,
-    Move m, Value ev)
+INLINE void tte_save(TranspositionTable *tt, TTEntry *tte, Key k, Value v,
+    bool pv, int b, Depth d, Move m, Value ev)
 {
+#ifdef TT_LOCKLESS
+  // Build the new entry in a local copy and store it back as a whole.
+  TTEntry *slot = tte, copy = *tte;
+  tte = &copy;
+#endif
+  bool sameKey = (uint16_t)k == tte_key(tte);
+
   // Preserve any existing move for the same position
-  if (m || (uint16_t)k != tte->key16)
+  if (m || !sameKey)
     tte->move16 = (uint16_t)m;
 
   // Don't overwrite more valuable entries
-  if (  (uint16_t)k != tte->key16
+  if (   !sameKey
       || d - DEPTH_OFFSET > tte->depth8 - 4
       || b == BOUND_EXACT)
   {
@@ -89,10 +144,19 @@ INLINE void tte_save(TTEntry *tte, Key k, Value v, bool pv, int b, Depth d,
 
     tte->key16     = (uint16_t)k;
     tte->depth8    = (uint8_t)(d - DEPTH_OFFSET);
-    tte->genBound8 = (uint8_t)(TT.generation8 | ((uint8_t)pv << 2) | b);
+    tte->genBound8 = (uint8_t)(tt->generation8 | ((uint8_t)pv << 2) | b);
+#ifndef TT_COMPACT
     tte->value16   = (int16_t)v;
     tte->eval16    = (int16_t)ev;
+#else
+    tte->value16   = (int16_t)(b == BOUND_NONE ? ev : v);
+#endif
   }
+
+#ifdef TT_LOCKLESS
+  copy.key16 = (uint16_t)k ^ tte_check(&copy);
+  *slot = copy;
+#endif
 }
 
 INLINE Move tte_move(TTEntry *tte)
@@ -100,6 +164,7 @@ INLINE Move tte_move(TTEntry *tte)
   return tte->move16;
 }
 
+#ifndef TT_COMPACT
 INLINE Value tte_value(TTEntry *tte)
 {
   return tte->value16;
@@ -109,6 +174,17 @@ INLINE Value tte_eval(TTEntry *tte)
 {
   return tte->eval16;
 }
+#else
+INLINE Value tte_value(TTEntry *tte)
+{
+  return (tte->genBound8 & 0x3) ? tte->value16 : VALUE_NONE;
+}
+
+INLINE Value tte_eval(TTEntry *tte)
+{
+  return (tte->genBound8 & 0x3) ? VALUE_NONE : tte->value16;
+}
+#endif
 
 INLINE Depth tte_depth(TTEntry *tte)
 {
@@ -125,22 +201,74 @@ INLINE int tte_bound(TTEntry *tte)
   return tte->genBound8 & 0x3;
 }
 
-void tt_free(void);
+// In TT_STATS builds (make ttstats=yes) each search thread counts how the
+// table behaves. A probe that misses returns the slot the search will store
+// into; if that slot still holds another position, the entry is counted as
+// evicted, bucketed by its depth and by how many searches old it is. A hit
+// whose move is not pseudo-legal reveals a false 16-bit key match.
 
-INLINE void tt_new_search(void)
+#ifdef TT_STATS
+enum { TTStatsDepths = 5, TTStatsAges = 4 };
+
+struct TTStats {
+  uint64_t falseHits, cutoffs, fills;
+  uint64_t evictions[TTStatsDepths][TTStatsAges]; // [depth][age]
+};
+
+INLINE void tt_stats_probe(TTStats *s, TranspositionTable *tt,
+    const TTEntry *tte, bool found)
 {
-  TT.generation8 += 8; // Lower 3 bits are used by PvNode and Bound
+  if (found)
+    return;
+  if (!tte->depth8) {
+    s->fills++;
+    return;
+  }
+  Depth d = tte->depth8 + DEPTH_OFFSET;
+  int depth = d <= 0 ? 0 : d <= 4 ? 1 : d <= 8 ? 2 : d <= 16 ? 3 : 4;
+  int age = ((263 + tt->generation8 - tte->genBound8) & 0xF8) >> 3;
+  s->evictions[depth][min(age, TTStatsAges - 1)]++;
 }
 
-INLINE TTEntry *tt_first_entry(Key key)
+void tt_stats_print(FILE *F, uint64_t probes, uint64_t hits, const TTStats *s);
+#endif
+
+void tt_free(TranspositionTable *tt);
+
+INLINE void tt_new_search(TranspositionTable *tt)
+{
+  tt->generation8 += 8; // Lower 3 bits are used by PvNode and Bound
+}
+
+INLINE TTEntry *tt_first_entry(TranspositionTable *tt, Key key)
 {
-  return &TT.table[mul_hi64(key, TT.clusterCount)].entry[0];
+  return &tt->table[mul_hi64(key, tt->clusterCount)].entry[0];
+}
+
+// tt_data() returns the entry the search should read after tt_probe():
+// the slot itself, or in TT_LOCKLESS builds the copy of it that tt_probe()
+// stored in *data (verified on a hit, the slot to be replaced on a miss).
+// Saves always go to the slot.
+
+INLINE TTEntry *tt_data(TTEntry *tte, TTEntry *data)
+{
+#ifdef TT_LOCKLESS
+  (void)tte;
+  return data;
+#else
+  (void)data;
+  return tte;
+#endif
 }
 
-TTEntry *tt_probe(Key key, bool *found);
-int tt_hashfull(void);
-void tt_allocate(size_t kbSize);
-void tt_clear(void);
-void tt_clear_worker(int idx);
+TTEntry *tt_probe(TranspositionTable *tt, Key key, bool *found, TTEntry *data);
+int tt_hashfull(TranspositionTable *tt);
+void tt_allocate(Engine *e, size_t kbSize);
+void tt_resize(Engine *e, size_t kbSize);
+void tt_resize_worker(Position *pos);
+void tt_clear(Engine *e);
+void tt_clear_worker(Position *pos);
+bool tt_save(Engine *e, const char *name);
+bool tt_load(Engine *e, const char *name);
 
 #endif
@@ -322,6 +322,13 @@ typedef struct RootMove RootMove;
 typedef struct RootMoves RootMoves;
 typedef struct PawnEntry PawnEntry;
 typedef struct MaterialEntry MaterialEntry;
+typedef struct MaterialHashEntry MaterialHashEntry;
+typedef struct Engine Engine;
+typedef struct TTStats TTStats;
+typedef struct EvalCache EvalCache;
+typedef struct EvalProfile EvalProfile;
+typedef struct SliderAttacks SliderAttacks;
+typedef struct Game Game;
 
 enum { MAX_LPH = 4 };
 
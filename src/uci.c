@@ -16,10 +16,12 @@
   along with this program.  If not, see <http://www.gnu.org/licenses/>.
 */
 
+#include <ctype.h>
+#include <inttypes.h>
 #include <stdio.h>
 #include <string.h>
-#include <ctype.h>
 
+#include "engine.h"
 #include "evaluate.h"
 #include "misc.h"
 #include "movegen.h"
@@ -34,59 +36,206 @@
 static const char StartFEN[] =
   "rnbqkbnr/pppppppp/8/8/8/8/PPPPPPPP/RNBQKBNR w KQkq - 0 1";
 
-// position() is called when the engine receives the "position" UCI
-// command. The function sets up the position described in the given FEN
-// string ("fen") or the starting position ("startpos") and then makes
-// the moves given in the following move list ("moves").
+// Game holds the game that was last set up by position() on a Position:
+// the FEN it started from and the moves played since. When a "position"
+// command only adds moves to that game, just the new moves are played. The
+// history keys that position() clears at the root are saved here, so that
+// the game can be resumed from where it was left.
 
-void position(Position *pos, char *str)
-{
+struct Game {
+  Stack *stack, *st;
+  Key key;
   char fen[128];
-  char *moves;
+  Move *moves;
+  int numMoves, maxMoves;
+  Key keys[100];
+  int pliesFromNull;
+};
 
-  moves = strstr(str, "moves");
-  if (moves) {
-    if (moves > str) moves[-1] = 0;
-    moves += 5;
+// game_resume() reverts the root preparation of position() so that moves
+// can be played on top of the current game. It returns false if pos has
+// been changed since it was last set up by position().
+
+static bool game_resume(Position *pos)
+{
+  Game *g = pos->game;
+
+  if (   !g
+      || g->stack != pos->stack
+      || g->st != pos->st
+      || g->key != pos->st->key)
+    return false;
+
+  pos->st->pliesFromNull = g->pliesFromNull;
+  for (int k = 0; k <= min(g->pliesFromNull, 99); k++)
+    (pos->st - k)->key = g->keys[k];
+  pos->hasRepeated = false;
+
+  return true;
+}
+
+// game_free() releases the game kept by position() for pos.
+
+void game_free(Position *pos)
+{
+  if (pos->game) {
+    free(pos->game->moves);
+    free(pos->game);
+    pos->game = NULL;
   }
+}
 
-  if (strncmp(str, "fen", 3) == 0) {
-    strncpy(fen, str + 4, 127);
-    fen[127] = 0;
-  } else if (strncmp(str, "startpos", 8) == 0)
-    strcpy(fen, StartFEN);
-  else
+// game_play() plays a move of the game, using the 100 slots starting at
+// pos->stack + 100 as a circular buffer.
+
+static void game_play(Position *pos, Move m)
+{
+  do_move(pos, m, gives_check(pos, pos->st, m));
+  pos->gamePly++;
+
+  // Roll over if we reach 100 plies.
+  if (pos->st == pos->stack + 200) {
+    memcpy(pos->st - 100, pos->st, StateSize);
+    pos->st -= 100;
+    pos_set_check_info(pos);
+  }
+
+  Game *g = pos->game;
+  if (g->numMoves == g->maxMoves) {
+    g->maxMoves += 256;
+    g->moves = realloc(g->moves, g->maxMoves * sizeof(Move));
+  }
+  g->moves[g->numMoves++] = m;
+}
+
+// game_play_list() plays the moves of a list in UCI format and returns the
+// number of moves played.
+
+static int game_play_list(Position *pos, char *list)
+{
+  int n = 0;
+
+  // The list is split without strtok(), since selfplay sets up positions
+  // from several threads at once.
+  for (char *s = list + strspn(list, " \t"); *s; s += strspn(s, " \t")) {
+    size_t len = strcspn(s, " \t");
+    char c = s[len];
+    s[len] = 0;
+    Move m = uci_to_move(pos, s);
+    s[len] = c;
+    if (!m) break;
+    game_play(pos, m);
+    n++;
+    s += len;
+  }
+
+  return n;
+}
+
+// game_goto() sets pos to the position after the first n moves of the
+// game by replaying them from the FEN the game started from. The moves
+// after them stay in g->moves until they are overwritten.
+
+static void game_goto(Position *pos, int n)
+{
+  Game *g = pos->game;
+  if (n == g->numMoves)
     return;
 
-  pos->st = pos->stack + 100; // Start of circular buffer of 100 slots.
-  pos_set(pos, fen, 0);
-  // pos_set(pos, fen, option_value(OPT_CHESS960));
+  pos->st = pos->stack + 100;
+  pos_set(pos, g->fen, is_chess960());
+  g->numMoves = 0;
+  for (int i = 0; i < n; i++)
+    game_play(pos, g->moves[i]);
+}
 
-  // Parse move list (if any).
-  if (moves) {
-    int ply = 0;
-
-    for (moves = strtok(moves, " \t"); moves; moves = strtok(NULL, " \t")) {
-      Move m = uci_to_move(pos, moves);
-      if (!m) break;
-      do_move(pos, m, gives_check(pos, pos->st, m));
-      pos->gamePly++;
-      // Roll over if we reach 100 plies.
-      if (++ply == 100) {
-        memcpy(pos->st - 100, pos->st, StateSize);
-        pos->st -= 100;
-        pos_set_check_info(pos);
-        ply -= 100;
-      }
+// game_connect() plays the given number of plies, at most two, that lead
+// from the current position to the position with the given key. It returns
+// false if there are no such moves.
+
+static bool game_connect(Position *pos, int plies, Key key)
+{
+  if (plies == 0)
+    return pos->st->key == key;
+
+  ExtMove list1[MAX_MOVES], list2[MAX_MOVES];
+  ExtMove *end1 = generate_legal(pos, list1);
+  for (ExtMove *m1 = list1; m1 < end1; m1++) {
+    Move found = 0;
+    if (plies == 1)
+      found = key_after(pos, m1->move) == key ? MOVE_NULL : 0;
+    else {
+      do_move(pos, m1->move, gives_check(pos, pos->st, m1->move));
+      ExtMove *end2 = generate_legal(pos, list2);
+      for (ExtMove *m2 = list2; m2 < end2 && !found; m2++)
+        if (key == key_after(pos, m2->move))
+          found = m2->move;
+      undo_move(pos, m1->move);
     }
 
-    // Make sure that is_draw() never tries to look back more than 99 ply.
-    // This is enough, since 100 ply history means draw by 50-move rule.
-    if (pos->st->pliesFromNull > 99)
-      pos->st->pliesFromNull = 99;
+    if (!found)
+      continue;
+    game_play(pos, m1->move);
+    if (found != MOVE_NULL)
+      game_play(pos, found);
+    return true;
+  }
+
+  return false;
+}
+
+// game_find_fen() looks for the position given by a FEN in the current
+// game. This happens when the GUI sends a bare FEN after every move, or the
+// FEN of the root followed by the moves to ponder on. The FEN must be one of
+// the positions of the game or be reached from one of them in one or two
+// plies, with the same hash key, 50-move counter and game ply. If it is
+// found, pos is set to it and true is returned. The moves of the game up to
+// that position are kept and the connecting moves are played. This keeps
+// the history needed for repetition detection, also when the GUI takes
+// back the moves pondered on.
+
+static bool game_find_fen(Position *pos, char *fen)
+{
+  Game *g = pos->game;
+
+  // Set up the FEN in a spare slot at the end of the stack to get its key.
+  Position tmp;
+  tmp.st = pos->stack + 214;
+  pos_set(&tmp, fen, is_chess960());
+  Key key = tmp.st->key;
+  int rule50 = tmp.st->rule50, gamePly = tmp.gamePly;
+
+  // The game ply of the FEN tells which positions of the game can lead to
+  // it. Try the one that needs the fewest connecting plies first.
+  int numMoves = g->numMoves, startPly = pos->gamePly - numMoves;
+  for (int plies = 0; plies <= 2; plies++) {
+    int n = gamePly - startPly - plies;
+    if (n < 0 || n > numMoves)
+      continue;
+    game_goto(pos, n);
+    if (game_connect(pos, plies, key) && pos->st->rule50 == rule50)
+      return true;
+  }
+
+  return false;
+}
+
+// game_set_root() prepares the current position of the game to be the root
+// of a search.
 
-    // Now move some of the game history at the end of the circular buffer
-    // in front of that buffer.
+static void game_set_root(Position *pos)
+{
+  Game *g = pos->game;
+  g->pliesFromNull = pos->st->pliesFromNull;
+
+  // Make sure that is_draw() never tries to look back more than 99 ply.
+  // This is enough, since 100 ply history means draw by 50-move rule.
+  if (pos->st->pliesFromNull > 99)
+    pos->st->pliesFromNull = 99;
+
+  // Now move some of the game history at the end of the circular buffer
+  // in front of that buffer.
+  if (g->numMoves > 0) {
     int k = (pos->st - (pos->stack + 100)) - max(7, pos->st->pliesFromNull);
     for (; k < 0; k++)
       memcpy(pos->stack + 100 + k, pos->stack + 200 + k, StateSize);
@@ -100,6 +249,8 @@ void position(Position *pos, char *str)
   // position coming before the root position. In addition, we set
   // pos->hasRepeated to indicate whether a position has repeated since
   // the last irreversible move.
+  for (int k = 0; k <= pos->st->pliesFromNull; k++)
+    g->keys[k] = (pos->st - k)->key;
   for (int k = 0; k <= pos->st->pliesFromNull; k++) {
     int l;
     for (l = k + 4; l <= pos->st->pliesFromNull; l += 2)
@@ -112,6 +263,94 @@ void position(Position *pos, char *str)
   }
   pos->rootKeyFlip ^= pos->st->key;
   pos->st->key ^= pos->rootKeyFlip;
+
+  g->stack = pos->stack;
+  g->st = pos->st;
+  g->key = pos->st->key;
+}
+
+// position() is called when the engine receives the "position" UCI
+// command. The function sets up the position described in the given FEN
+// string ("fen") or the starting position ("startpos") and then makes
+// the moves given in the following move list ("moves"). If the command
+// extends the game set up by the previous one, only the new moves are
+// made. If the FEN is a position of that game, or follows one of them in
+// one or two plies, the game is continued from there.
+
+void position(Position *pos, char *str)
+{
+  char fen[128];
+  char *moves;
+
+  moves = strstr(str, "moves");
+  if (moves) {
+    if (moves > str) moves[-1] = 0;
+    moves += 5;
+  }
+
+  if (strncmp(str, "fen", 3) == 0) {
+    strncpy(fen, str + 4, 127);
+    fen[127] = 0;
+  } else if (strncmp(str, "startpos", 8) == 0)
+    strcpy(fen, StartFEN);
+  else
+    return;
+
+  if (game_resume(pos)) {
+    // Check whether the move list starts with the moves of the game.
+    Game *g = pos->game;
+    if (strcmp(fen, g->fen) == 0) {
+      char buf[8], *s = moves;
+      int i = 0;
+      for (; s && i < g->numMoves; i++) {
+        s += strspn(s, " \t");
+        size_t len = strcspn(s, " \t");
+        uci_move(buf, g->moves[i], is_chess960());
+        if (len != strlen(buf) || strncmp(s, buf, len))
+          break;
+        s += len;
+      }
+      if (i == g->numMoves) {
+        if (s)
+          game_play_list(pos, s);
+        game_set_root(pos);
+        return;
+      }
+    }
+    if (game_find_fen(pos, fen)) {
+      if (moves)
+        game_play_list(pos, moves);
+      game_set_root(pos);
+      return;
+    }
+  }
+
+  pos->st = pos->stack + 100; // Start of circular buffer of 100 slots.
+  pos_set(pos, fen, 0);
+  // pos_set(pos, fen, option_value(OPT_CHESS960));
+  if (!pos->game)
+    pos->game = calloc(1, sizeof(Game));
+  strcpy(pos->game->fen, fen);
+  pos->game->numMoves = 0;
+
+  // Parse move list (if any).
+  if (moves)
+    game_play_list(pos, moves);
+
+  game_set_root(pos);
+}
+
+
+// moves_cmd() is called when the engine receives the "moves" command. It
+// makes the given moves on top of the current game.
+
+static void moves_cmd(Position *pos, char *str)
+{
+  if (!game_resume(pos))
+    return;
+
+  game_play_list(pos, str);
+  game_set_root(pos);
 }
 
 
@@ -154,6 +393,52 @@ error:
 }
 
 
+// perft_cmd() counts the leaf nodes of the legal move tree up to the given
+// depth and reports the total together with the time taken. This is called
+// for "go perft <depth>" and, listing the count for each root move, for
+// "divide <depth>".
+
+static void perft_cmd(Position *pos, Depth depth, bool divide)
+{
+  process_delayed_settings();
+
+  TimePoint elapsed = now();
+  uint64_t nodes = perft(pos, depth, divide);
+  elapsed = now() - elapsed + 1;
+
+  printf("\nNodes searched: %" PRIu64 "\nTime (ms): %" PRIi64
+         "\nNodes/second: %" PRIu64 "\n", nodes, elapsed,
+         1000 * nodes / elapsed);
+  fflush(stdout);
+}
+
+
+// hash_file() is called for the "savehash" and "loadhash" commands. It
+// writes the transposition table to the given file or reads it back, once
+// a running search has finished. Since ucinewgame clears the table, a saved
+// table is loaded after it.
+
+static void hash_file(char *str, bool load)
+{
+  Engine *e = &DefaultEngine;
+  char *end = str + strlen(str);
+  while (end > str && isblank(end[-1]))
+    *--end = 0;
+
+  if (e->threads.searching)
+    thread_wait_until_sleeping(threads_main(e));
+  process_delayed_settings();
+
+  if (!*str || !(load ? tt_load(e, str) : tt_save(e, str))) {
+    fprintf(stderr, "Unable to %s hash file: %s\n",
+            load ? "load" : "save", str);
+    return;
+  }
+  printf("info string Hash %s %s\n", load ? "loaded from" : "saved to", str);
+  fflush(stdout);
+}
+
+
 // go() is called when engine receives the "go" UCI command. The function sets
 // the thinking time and other parameters from the input string, then starts
 // the search.
@@ -162,44 +447,51 @@ static void go(Position *pos, char *str)
 {
   char *token;
   bool ponderMode = false;
+  LimitsType *limits = &pos->engine->limits;
 
   process_delayed_settings();
 
-  Limits = (struct LimitsType){ 0 };
-  Limits.startTime = now(); // As early as possible!
+  *limits = (struct LimitsType){ 0 };
+  limits->startTime = now(); // As early as possible!
 
   for (token = strtok(str, " \t"); token; token = strtok(NULL, " \t")) {
     if (strcmp(token, "searchmoves") == 0)
       while ((token = strtok(NULL, " \t")))
-        Limits.searchmoves[Limits.numSearchmoves++] = uci_to_move(pos, token);
+        limits->searchmoves[limits->numSearchmoves++] = uci_to_move(pos, token);
     else if (strcmp(token, "wtime") == 0)
-      Limits.time[WHITE] = atoi(strtok(NULL, " \t"));
+      limits->time[WHITE] = atoi(strtok(NULL, " \t"));
     else if (strcmp(token, "btime") == 0)
-      Limits.time[BLACK] = atoi(strtok(NULL, " \t"));
+      limits->time[BLACK] = atoi(strtok(NULL, " \t"));
     else if (strcmp(token, "winc") == 0)
-      Limits.inc[WHITE] = atoi(strtok(NULL, " \t"));
+      limits->inc[WHITE] = atoi(strtok(NULL, " \t"));
     else if (strcmp(token, "binc") == 0)
-      Limits.inc[BLACK] = atoi(strtok(NULL, " \t"));
+      limits->inc[BLACK] = atoi(strtok(NULL, " \t"));
     else if (strcmp(token, "movestogo") == 0)
-      Limits.movestogo = atoi(strtok(NULL, " \t"));
+      limits->movestogo = atoi(strtok(NULL, " \t"));
     else if (strcmp(token, "depth") == 0)
-      Limits.depth = atoi(strtok(NULL, " \t"));
+      limits->depth = atoi(strtok(NULL, " \t"));
     else if (strcmp(token, "nodes") == 0)
-      Limits.nodes = strtoull(strtok(NULL, " \t"), NULL, 10);
+      limits->nodes = strtoull(strtok(NULL, " \t"), NULL, 10);
     else if (strcmp(token, "movetime") == 0)
-      Limits.movetime = atoi(strtok(NULL, " \t"));
+      limits->movetime = atoi(strtok(NULL, " \t"));
     else if (strcmp(token, "mate") == 0)
-      Limits.mate = atoi(strtok(NULL, " \t"));
+      limits->mate = atoi(strtok(NULL, " \t"));
     else if (strcmp(token, "infinite") == 0)
-      Limits.infinite = true;
+      limits->infinite = true;
     else if (strcmp(token, "ponder") == 0)
       ponderMode = true;
+    else if (strcmp(token, "perft") == 0) {
+      token = strtok(NULL, " \t");
+      perft_cmd(pos, token ? atoi(token) : 1, false);
+      return;
+    }
   }
 
   start_thinking(pos, ponderMode);
 }
 
 
+
 // uci_loop() waits for a command from stdin, parses it and calls the
 // appropriate function. Also intercepts EOF from stdin to ensure
 // gracefully exiting if the GUI dies unexpectedly. When called with some
@@ -213,21 +505,20 @@ void uci_loop(int argc, char **argv)
   char fen[strlen(StartFEN) + 1];
   char str_buf[64];
   char *token;
-
-  LOCK_INIT(Threads.lock);
+  Engine *e = &DefaultEngine;
 
   // Threads.searching is only read and set by the UI thread.
   // The UI thread uses it to know whether it must still call
   // thread_wait_until_sleeping() on the main search thread.
   // (This is important for our native Windows threading implementation.)
-  Threads.searching = false;
+  e->threads.searching = false;
 
   // Threads.sleeping is set by the main search thread if it has run
   // out of work but must wait for a "stop" or "ponderhit" command from
   // the GUI to arrive before being allowed to output "bestmove". The main
   // thread will then go to sleep and has to be waken up by the UI thread.
   // This variable must be accessed only after acquiring Threads.lock.
-  Threads.sleeping = false;
+  e->threads.sleeping = false;
 
   // Allocate 215 Stack slots.
   // Slots 100-200 form a circular buffer to be filled with game moves.
@@ -239,6 +530,8 @@ void uci_loop(int argc, char **argv)
   pos.moveList = malloc(1000 * sizeof(ExtMove));
   pos.st = pos.stack + 100;
   pos.st[-1].endMoves = pos.moveList;
+  pos.engine = e;
+  pos.game = NULL;
 
   size_t buf_size = 1;
   for (int i = 1; i < argc; i++)
@@ -285,26 +578,26 @@ void uci_loop(int argc, char **argv)
     // already searched long enough), otherwise we should continue searching
     // but switch from pondering to normal search.
     if (strcmp(token, "quit") == 0 || strcmp(token, "stop") == 0) {
-      if (Threads.searching) {
-        Threads.stop = true;
-        LOCK(Threads.lock);
-        if (Threads.sleeping)
-          thread_wake_up(threads_main(), THREAD_RESUME);
-        Threads.sleeping = false;
-        UNLOCK(Threads.lock);
+      if (e->threads.searching) {
+        e->threads.stop = true;
+        LOCK(e->threads.lock);
+        if (e->threads.sleeping)
+          thread_wake_up(threads_main(e), THREAD_RESUME);
+        e->threads.sleeping = false;
+        UNLOCK(e->threads.lock);
       }
     }
     else if (strcmp(token, "ponderhit") == 0) {
-      Threads.ponder = false; // Switch to normal search
-      if (Threads.stopOnPonderhit)
-        Threads.stop = true;
-      LOCK(Threads.lock);
-      if (Threads.sleeping) {
-        Threads.stop = true;
-        thread_wake_up(threads_main(), THREAD_RESUME);
-        Threads.sleeping = false;
+      e->threads.ponder = false; // Switch to normal search
+      if (e->threads.stopOnPonderhit)
+        e->threads.stop = true;
+      LOCK(e->threads.lock);
+      if (e->threads.sleeping) {
+        e->threads.stop = true;
+        thread_wake_up(threads_main(e), THREAD_RESUME);
+        e->threads.sleeping = false;
       }
-      UNLOCK(Threads.lock);
+      UNLOCK(e->threads.lock);
     }
     else if (strcmp(token, "uci") == 0) {
       flockfile(stdout);
@@ -312,13 +605,17 @@ void uci_loop(int argc, char **argv)
       // print_engine_info(true);
       printf("\n");
       // print_options();
+#ifdef TUNE
+      // Tuning frontends only set options that the engine announces.
+      print_options();
+#endif
       printf("uciok\n");
       fflush(stdout);
       funlockfile(stdout);
     }
     else if (strcmp(token, "ucinewgame") == 0) {
       process_delayed_settings();
-      search_clear();
+      search_clear(e);
     } else if (strcmp(token, "isready") == 0) {
       process_delayed_settings();
       printf("readyok\n");
@@ -326,21 +623,33 @@ void uci_loop(int argc, char **argv)
     }
     else if (strcmp(token, "go") == 0)        go(&pos, str);
     else if (strcmp(token, "position") == 0)  position(&pos, str);
+    else if (strcmp(token, "moves") == 0)     moves_cmd(&pos, str);
     else if (strcmp(token, "setoption") == 0) setoption(str);
+    else if (strcmp(token, "bench") == 0)     benchmark(&pos, str);
+    else if (strcmp(token, "microbench") == 0) microbench(&pos, str);
+    else if (strcmp(token, "eval") == 0)      eval_cmd(&pos);
+    else if (strcmp(token, "evalprofile") == 0) evalprofile(&pos, str);
+    else if (strcmp(token, "memstat") == 0)   memstat();
+    else if (strcmp(token, "ttstats") == 0)   ttstats();
+    else if (strcmp(token, "savehash") == 0)  hash_file(str, false);
+    else if (strcmp(token, "loadhash") == 0)  hash_file(str, true);
+    else if (strcmp(token, "divide") == 0)    perft_cmd(&pos, atoi(str), true);
+    else if (strcmp(token, "selfplay") == 0)  selfplay(&pos, str);
     else if (strncmp(token, "#", 1)) {
       printf("Unknown command: %s %s\n", token, str);
       fflush(stdout);
     }
   } while (argc == 1 && strcmp(token, "quit") != 0);
 
-  if (Threads.searching)
-    thread_wait_until_sleeping(threads_main());
+  if (e->threads.searching)
+    thread_wait_until_sleeping(threads_main(e));
 
   free(cmd);
+  game_free(&pos);
   free(pos.stackAllocation);
   free(pos.moveList);
 
-  LOCK_DESTROY(Threads.lock);
+  LOCK_DESTROY(e->threads.lock);
 }
 
 
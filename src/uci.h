@@ -40,6 +40,8 @@ enum {
   // OPT_ANALYSIS_CONTEMPT,
   OPT_THREADS,
   OPT_HASH,
+  OPT_MEMORY_BUDGET,
+  OPT_EVAL_CACHE,
   // OPT_CLEAR_HASH,
   // OPT_PONDER,
   // OPT_MULTI_PV,
@@ -65,6 +67,7 @@ enum {
 #endif
 #endif
   OPT_LARGE_PAGES,
+  OPT_PERFT_HASH,
   // OPT_NUMA
 };
 
@@ -89,6 +92,15 @@ bool option_set_by_name(char *name, char *value);
 
 void setoption(char *str);
 void position(Position *pos, char *str);
+void game_free(Position *pos);
+void benchmark(Position *pos, char *str);
+void microbench(Position *pos, char *str);
+void eval_cmd(Position *pos);
+void evalprofile(Position *pos, char *str);
+size_t static_tables_memory(bool print);
+void memstat(void);
+void ttstats(void);
+void selfplay(Position *pos, char *str);
 
 void uci_loop(int argc, char* argv[]);
 char *uci_value(char *str, Value v);
@@ -27,9 +27,11 @@
 #include <sys/mman.h>
 #endif
 
+#include "engine.h"
 #include "evaluate.h"
 #include "misc.h"
 #include "numa.h"
+#include "params.h"
 #include "search.h"
 #include "settings.h"
 #include "thread.h"
@@ -42,7 +44,7 @@ static void on_clear_hash(Option *opt)
   (void)opt;
 
   if (settings.ttSize)
-    search_clear();
+    search_clear(&DefaultEngine);
 }
 
 static void on_hash_size(Option *opt)
@@ -50,6 +52,16 @@ static void on_hash_size(Option *opt)
   delayedSettings.ttSize = opt->value;
 }
 
+static void on_memory_budget(Option *opt)
+{
+  delayedSettings.memoryBudget = opt->value;
+}
+
+static void on_eval_cache(Option *opt)
+{
+  delayedSettings.evalCacheSize = opt->value;
+}
+
 static void on_numa(Option *opt)
 {
 #ifdef NUMA
@@ -79,6 +91,46 @@ static void on_best_book_move(Option *opt) {}
 
 static void on_book_depth(Option *opt) {}
 
+#ifdef TUNE
+// Tunable parameters. The options set the values of the UCI engine.
+// Changing any of them recomputes its reduction table, which depends on
+// reductionInit.
+#define PARAM(n, v, lo, hi) \
+  _Thread_local int n = v; \
+  static void on_##n(Option *opt) \
+  { DefaultEngine.params.n = opt->value; search_init(&DefaultEngine); }
+PARAMS
+#undef PARAM
+
+const Params DefaultParams = {
+#define PARAM(n, v, lo, hi) v,
+  PARAMS
+#undef PARAM
+};
+
+// params_load() copies a set of parameter values into the thread-local
+// variables of the calling thread.
+
+void params_load(const Params *p)
+{
+#define PARAM(n, v, lo, hi) n = p->n;
+  PARAMS
+#undef PARAM
+}
+
+// params_set() sets a parameter in a set of values, clamped to its range.
+// It returns false if there is no parameter of that name.
+
+bool params_set(Params *p, const char *name, int value)
+{
+#define PARAM(n, v, lo, hi) \
+  if (strcasecmp(name, #n) == 0) { p->n = clamp(value, lo, hi); return true; }
+  PARAMS
+#undef PARAM
+  return false;
+}
+#endif
+
 #ifdef IS_64BIT
 #define MAXHASHMB 33554432
 #else
@@ -91,6 +143,8 @@ static Option optionsMap[] = {
   //   "Off var Off var White var Black", NULL, 0, NULL },
   { "Threads", OPT_TYPE_SPIN, 1, 1, MAX_THREADS, NULL, on_threads, 0, NULL },
   { "Hash", OPT_TYPE_SPIN, 1024, 1, MAXHASHMB, NULL, on_hash_size, 0, NULL },
+  { "MemoryBudget", OPT_TYPE_SPIN, 0, 0, MAXHASHMB, NULL, on_memory_budget, 0, NULL },
+  { "EvalCache", OPT_TYPE_SPIN, EVAL_CACHE_KB, 0, 65536, NULL, on_eval_cache, 0, NULL },
   // { "Clear Hash", OPT_TYPE_BUTTON, 0, 0, 0, NULL, on_clear_hash, 0, NULL },
   // { "Ponder", OPT_TYPE_CHECK, 0, 0, 0, NULL, NULL, 0, NULL },
   // { "MultiPV", OPT_TYPE_SPIN, 1, 1, 500, NULL, NULL, 0, NULL },
@@ -117,6 +171,12 @@ static Option optionsMap[] = {
 #endif
 #endif
   { "LargePages", OPT_TYPE_CHECK, 0, 0, 0, NULL, on_large_pages, 0, NULL },
+  { "PerftHash", OPT_TYPE_SPIN, 0, 0, 4096, NULL, NULL, 0, NULL },
+#ifdef TUNE
+#define PARAM(n, v, lo, hi) { #n, OPT_TYPE_SPIN, v, lo, hi, NULL, on_##n, 0, NULL },
+  PARAMS
+#undef PARAM
+#endif
   // { "NUMA", OPT_TYPE_STRING, 0, 0, 0, "all", on_numa, 0, NULL },
   { 0 }
 };
@@ -141,6 +201,9 @@ void options_init()
   if (!large_pages_supported())
     optionsMap[OPT_LARGE_PAGES].type = OPT_TYPE_DISABLED;
 #endif
+#ifdef NNUE_PURE
+  optionsMap[OPT_EVAL_CACHE].type = OPT_TYPE_DISABLED;
+#endif
 #if defined(__linux__) && !defined(MADV_HUGEPAGE)
   optionsMap[OPT_LARGE_PAGES].type = OPT_TYPE_DISABLED;
 #endif